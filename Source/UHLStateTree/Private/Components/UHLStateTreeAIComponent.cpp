@@ -2,10 +2,55 @@
 
 #include "Components/UHLStateTreeAIComponent.h"
 
+#include "AIController.h"
+#include "Components/StateTreeAIComponentSchema.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/Pawn.h"
 #include "Misc/EngineVersion.h" 
 #include "Misc/EngineVersionComparison.h"
+#include "StateTree.h"
 #include "StateTreeExecutionContext.h"
 #include "StateTreeReference.h"
+#include "UHLStateTree.h"
+#include "Core/UHLStateTreeAssetUtils.h"
+#include "Core/UHLStateTreeMemory.h"
+#include "Core/UHLStateTreeTelemetry.h"
+#include "Net/UHLMontageReplicatorObject.h"
+#include "Subsystems/UHLFocusRotationSubsystem.h"
+#include "Subsystems/UHLStateTreeInstancePoolSubsystem.h"
+
+namespace UHLStateTreeSleep
+{
+	static float MaxSleepSeconds = 2.0f;
+	static FAutoConsoleVariableRef CVarMaxSleepSeconds(
+		TEXT("uhl.StateTree.MaxSleepSeconds"),
+		MaxSleepSeconds,
+		TEXT("Longest time a sleeping UHL StateTree component goes without a tick, 0 sleeps until woken up."));
+}
+
+static void UHL_CarryOverParameters(const FInstancedPropertyBag& From, FInstancedPropertyBag& To)
+{
+	const UPropertyBag* FromBag = From.GetPropertyBagStruct();
+	const UPropertyBag* ToBag = To.GetPropertyBagStruct();
+	if (!FromBag || !ToBag) return;
+
+	// different trees have different property IDs, match by name
+	for (const FPropertyBagPropertyDesc& ToDesc : ToBag->GetPropertyDescs())
+	{
+		const FPropertyBagPropertyDesc* FromDesc = FromBag->FindPropertyDescByName(ToDesc.Name);
+		if (!FromDesc || !FromDesc->CachedProperty || !ToDesc.CachedProperty || !FromDesc->CompatibleType(ToDesc)) continue;
+
+		ToDesc.CachedProperty->CopyCompleteValue(
+			ToDesc.CachedProperty->ContainerPtrToValuePtr<void>(To.GetMutableValue().GetMemory()),
+			FromDesc->CachedProperty->ContainerPtrToValuePtr<void>(From.GetValue().GetMemory()));
+	}
+}
+
+UUHLStateTreeAIComponent* UUHLStateTreeAIComponent::FindForController(const AAIController* Controller)
+{
+	return Controller ? Cast<UUHLStateTreeAIComponent>(Controller->GetBrainComponent()) : nullptr;
+}
 
 void UUHLStateTreeAIComponent::SetStateTreeReference(const FStateTreeReference& NewRef, const FStateTreeReferenceOverrides& NewOverrides)
 {
@@ -16,6 +61,651 @@ void UUHLStateTreeAIComponent::SetStateTreeReference(const FStateTreeReference&
 
 	// If you want to ensure your parameters match the new tree
 	StateTreeRef.SyncParameters();
+
+	InvalidateContextCache();
+	WakeUp();
+
+	// parallel tick was allowed for the previous trees only
+	if (IsRunning())
+	{
+		UnregisterTickScheduling();
+		RegisterTickScheduling();
+	}
+
+	RequestMontagePreload();
+}
+
+void UUHLStateTreeAIComponent::SwapStateTreeAsync(TSoftObjectPtr<UStateTree> NewStateTree, const TMap<FGameplayTag, TSoftObjectPtr<UStateTree>>& NewLinkedOverrides, bool bCarryOverParameters)
+{
+	CancelPendingStateTreeSwap();
+	if (NewStateTree.IsNull())
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("%s: SwapStateTreeAsync called without a StateTree"), *GetNameSafe(GetOwner()));
+		return;
+	}
+
+	PendingSwapStateTree = NewStateTree;
+	PendingSwapOverrides = NewLinkedOverrides;
+	bPendingSwapCarryOverParameters = bCarryOverParameters;
+
+	TArray<FSoftObjectPath> Paths;
+	Paths.Add(NewStateTree.ToSoftObjectPath());
+	for (const TPair<FGameplayTag, TSoftObjectPtr<UStateTree>>& Pair : NewLinkedOverrides)
+	{
+		if (!Pair.Value.IsNull())
+		{
+			Paths.Add(Pair.Value.ToSoftObjectPath());
+		}
+	}
+
+	// completes right away if everything is resident
+	SwapLoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		MoveTemp(Paths),
+		FStreamableDelegate::CreateWeakLambda(this, [this]()
+		{
+			bSwapReady = true;
+			if (IsRunning())
+			{
+				// swap at the start of the next tree tick
+				RequestImmediateTick();
+			}
+			else
+			{
+				ApplyPendingStateTreeSwap();
+			}
+		}),
+		FStreamableManager::AsyncLoadHighPriority);
+}
+
+bool UUHLStateTreeAIComponent::HasPendingStateTreeSwap() const
+{
+	return bSwapReady || (SwapLoadHandle.IsValid() && SwapLoadHandle->IsLoadingInProgress());
+}
+
+void UUHLStateTreeAIComponent::ApplyPendingStateTreeSwap()
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_InstanceData);
+	if (!bSwapReady) return;
+	bSwapReady = false;
+
+	UStateTree* NewStateTree = PendingSwapStateTree.Get();
+	if (!NewStateTree)
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("%s: failed to load %s for StateTree swap"), *GetNameSafe(GetOwner()), *PendingSwapStateTree.ToString());
+		CancelPendingStateTreeSwap();
+		return;
+	}
+
+	FStateTreeReferenceOverrides NewOverrides;
+	for (const TPair<FGameplayTag, TSoftObjectPtr<UStateTree>>& Pair : PendingSwapOverrides)
+	{
+		if (UStateTree* LinkedStateTree = Pair.Value.Get())
+		{
+			FStateTreeReference LinkedRef;
+			LinkedRef.SetStateTree(LinkedStateTree);
+			NewOverrides.AddOverride(Pair.Key, MoveTemp(LinkedRef));
+		}
+	}
+
+	const bool bWasRunning = IsRunning();
+	if (bWasRunning && NewStateTree == StateTreeRef.GetStateTree())
+	{
+		// same root tree, the run continues. Execution contexts pick up the overrides on the next tick,
+		// active linked subtrees keep running and new ones are used the next time their state is entered
+		LinkedStateTreeOverrides = MoveTemp(NewOverrides);
+		InvalidateContextCache();
+		CancelPendingStateTreeSwap();
+		RequestMontagePreload();
+		// parallel tick depends on the thread safety of the linked trees
+		UnregisterTickScheduling();
+		RegisterTickScheduling();
+		return;
+	}
+
+	FStateTreeReference NewRef;
+	NewRef.SetStateTree(NewStateTree);
+	if (bPendingSwapCarryOverParameters)
+	{
+		UHL_CarryOverParameters(StateTreeRef.GetParameters(), NewRef.GetMutableParameters());
+	}
+
+	// a different root tree can't take over the running instance data, the run restarts on it
+	if (bWasRunning)
+	{
+		StopLogic(TEXT("StateTree swap"));
+	}
+
+	StateTreeRef = MoveTemp(NewRef);
+	LinkedStateTreeOverrides = MoveTemp(NewOverrides);
+	InvalidateContextCache();
+
+	// new assets are held by the reference from now on
+	CancelPendingStateTreeSwap();
+
+	if (bWasRunning)
+	{
+		StartLogic();
+	}
+	else
+	{
+		RequestMontagePreload();
+	}
+}
+
+void UUHLStateTreeAIComponent::CancelPendingStateTreeSwap()
+{
+	if (SwapLoadHandle.IsValid())
+	{
+		SwapLoadHandle->ReleaseHandle();
+		SwapLoadHandle.Reset();
+	}
+	PendingSwapStateTree.Reset();
+	PendingSwapOverrides.Reset();
+	bSwapReady = false;
+}
+
+bool UUHLStateTreeAIComponent::SaveSnapshot(FUHLStateTreeSnapshot& OutSnapshot)
+{
+	if (!StateTreeRef.IsValid()) return false;
+
+	OutSnapshot.StateTree = StateTreeRef.GetStateTree();
+	return UHLStateTreeSnapshot::Write(InstanceData, TagCooldowns, GetWorld()->GetTimeSeconds(), OutSnapshot.Data);
+}
+
+bool UUHLStateTreeAIComponent::RestoreSnapshot(const FUHLStateTreeSnapshot& Snapshot)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_InstanceData);
+	if (!Snapshot.IsValid() || !StateTreeRef.IsValid()) return false;
+	if (Snapshot.StateTree.ToSoftObjectPath() != FSoftObjectPath(StateTreeRef.GetStateTree()))
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("%s: snapshot of %s doesn't match StateTree %s"),
+			*GetNameSafe(GetOwner()), *Snapshot.StateTree.ToString(), *GetNameSafe(StateTreeRef.GetStateTree()));
+		return false;
+	}
+
+	FStateTreeInstanceData RestoredInstanceData;
+	FUHLTagCooldowns RestoredTagCooldowns;
+	if (!UHLStateTreeSnapshot::Read(Snapshot.Data, GetWorld()->GetTimeSeconds(), RestoredInstanceData, RestoredTagCooldowns))
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("%s: failed to read StateTree snapshot"), *GetNameSafe(GetOwner()));
+		return false;
+	}
+
+	if (IsRunning())
+	{
+		StopLogic(TEXT("Snapshot restore"));
+	}
+	InstanceData = MoveTemp(RestoredInstanceData);
+	TagCooldowns = MoveTemp(RestoredTagCooldowns);
+	InvalidateContextCache();
+
+	// snapshot of a stopped tree
+	if (!IsRunning()) return true;
+
+	// same as StartLogic around the tree start, the restored states are already entered
+	SetComponentTickEnabled(true);
+	RequestMontagePreload();
+	OnLogicStarted();
+	return true;
+}
+
+void UUHLStateTreeAIComponent::StartLogic()
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_InstanceData);
+	RequestMontagePreload();
+
+	if (bUseInstanceDataPool && !bInstanceDataAcquired && StateTreeRef.IsValid())
+	{
+		bInstanceDataAcquired = true;
+		if (UUHLStateTreeInstancePoolSubsystem* Pool = UUHLStateTreeInstancePoolSubsystem::Get(GetWorld()))
+		{
+			Pool->Acquire(StateTreeRef.GetStateTree(), InstanceData);
+		}
+	}
+
+	Super::StartLogic();
+
+	OnLogicStarted();
+}
+
+void UUHLStateTreeAIComponent::OnLogicStarted()
+{
+	if (IsRunning() && !bCountedActive)
+	{
+		bCountedActive = true;
+		UHLStateTreeTelemetry::AddActiveAgent(1);
+	}
+
+	PrebuildMontageTable();
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION == 5
+	PrebuildSleepInfo();
+#endif
+	RegisterFocusRotation();
+	RegisterTickScheduling();
+}
+
+void UUHLStateTreeAIComponent::StopLogic(const FString& Reason)
+{
+	Super::StopLogic(Reason);
+
+	if (bCountedActive)
+	{
+		bCountedActive = false;
+		UHLStateTreeTelemetry::AddActiveAgent(-1);
+	}
+
+	// nodes exiting on stop release their focus, drop whatever is left
+	FocusArbiter.Reset(AIOwner);
+	UnregisterTickScheduling();
+	UnregisterFocusRotation();
+	ReleaseMontagePreload();
+	SetTickRate(EUHLStateTreeTickRate::EveryFrame);
+}
+
+void UUHLStateTreeAIComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	CancelPendingStateTreeSwap();
+	UnregisterTickScheduling();
+	UnregisterFocusRotation();
+	ReleaseMontagePreload();
+
+	Super::EndPlay(EndPlayReason);
+
+	if (bCountedActive)
+	{
+		bCountedActive = false;
+		UHLStateTreeTelemetry::AddActiveAgent(-1);
+	}
+
+	if (bUseInstanceDataPool && !IsRunning() && StateTreeRef.IsValid())
+	{
+		if (UUHLStateTreeInstancePoolSubsystem* Pool = UUHLStateTreeInstancePoolSubsystem::Get(GetWorld()))
+		{
+			Pool->Release(StateTreeRef.GetStateTree(), InstanceData);
+		}
+	}
+}
+
+void UUHLStateTreeAIComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_InstanceData);
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (bCatchUpDeltaTime)
+	{
+		bCatchUpDeltaTime = false;
+		DeltaTime = FMath::Max(DeltaTime, static_cast<float>(Now - LastTreeTickTime));
+	}
+	LastTreeTickTime = Now;
+
+	ApplyPendingStateTreeSwap();
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	if (IsRunning())
+	{
+		UHLStateTreeTelemetry::AddAgentTick(FPlatformTime::Cycles64() - StartCycles, TagCooldowns.CooldownTagsMap.Num());
+	}
+
+	PostTreeTick();
+}
+
+void UUHLStateTreeAIComponent::TickParallel(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_InstanceData);
+	if (!IsRunning() || IsPaused() || !StateTreeRef.IsValid()) return;
+
+	LastTreeTickTime = GetWorld()->GetTimeSeconds();
+
+	// RegisterTickScheduling checked the tree, changing it unregisters the agent first
+	checkSlow(UHLStateTreeParallel::IsTreeThreadSafe(StateTreeRef.GetStateTree(), &LinkedStateTreeOverrides));
+
+	// same as UStateTreeComponent::TickComponent, with game thread work deferred
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	UHLStateTreeParallel::FCommandScope CommandScope(ParallelCommands);
+	FStateTreeExecutionContext Context(*GetOwner(), *StateTreeRef.GetStateTree(), InstanceData);
+	if (SetContextRequirements(Context))
+	{
+		const EStateTreeRunStatus PreviousRunStatus = Context.GetStateTreeRunStatus();
+		const EStateTreeRunStatus CurrentRunStatus = Context.Tick(DeltaTime);
+		if (CurrentRunStatus != PreviousRunStatus)
+		{
+			UHLStateTreeParallel::RunOnGameThread([this, CurrentRunStatus]()
+			{
+				OnStateTreeRunStatusChanged.Broadcast(CurrentRunStatus);
+			});
+		}
+
+		// same as the game thread path, a tree that stopped during the tick isn't counted
+		if (IsRunning())
+		{
+			UHLStateTreeTelemetry::AddAgentTick(FPlatformTime::Cycles64() - StartCycles, TagCooldowns.CooldownTagsMap.Num());
+		}
+	}
+}
+
+void UUHLStateTreeAIComponent::FinishParallelTick()
+{
+	ParallelCommands.Execute();
+	PostTreeTick();
+}
+
+void UUHLStateTreeAIComponent::PostTreeTick()
+{
+	// once per frame, after all nodes submitted their focus
+	if (FocusArbiter.HasPendingChanges())
+	{
+		FocusArbiter.Resolve(AIOwner);
+	}
+
+	if (bImmediateTickRequested)
+	{
+		bImmediateTickRequested = false;
+		if (!bTickScheduled)
+		{
+			SetComponentTickIntervalAndCooldown(GetTickRateInterval());
+		}
+	}
+
+	if (bAllowSleep)
+	{
+		TrySleep();
+	}
+}
+
+void UUHLStateTreeAIComponent::TrySleep()
+{
+	if (bSleeping || !IsRunning() || IsPaused() || !StateTreeRef.IsValid()) return;
+	if (InstanceData.GetEventQueue().HasEvents()) return;
+
+	using namespace UHLStateTreeSleep;
+	double SleepDuration = MaxSleepSeconds > 0.0f ? MaxSleepSeconds : TNumericLimits<double>::Max();
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 6)
+	// UStateTreeComponent already schedules its own tick from the same info, only scheduler ticked agents need us
+	if (!bTickScheduled) return;
+
+	const FStateTreeReadOnlyExecutionContext Context(*GetOwner(), *StateTreeRef.GetStateTree(), InstanceData);
+	const FStateTreeScheduledTick NextTick = Context.GetNextScheduledTick();
+	if (NextTick.HasCustomTickRate())
+	{
+		SleepDuration = FMath::Min(SleepDuration, static_cast<double>(NextTick.GetTickRate()));
+	}
+	else if (!NextTick.ShouldSleep())
+	{
+		return;
+	}
+#else
+	if (HasTickingActiveNodes()) return;
+#endif
+	// the tick rate would tick it as often anyway
+	if (SleepDuration <= GetTickRateInterval()) return;
+
+	UUHLStateTreeSubsystem* Subsystem = UUHLStateTreeSubsystem::Get(GetWorld());
+	if (!Subsystem) return;
+
+	bSleeping = true;
+	UHLStateTreeTelemetry::AddSleepingAgent(1);
+	const double Now = GetWorld()->GetTimeSeconds();
+	WakeUpTime = SleepDuration < TNumericLimits<double>::Max() ? Now + SleepDuration : SleepDuration;
+	if (!bTickScheduled)
+	{
+		SetComponentTickEnabled(false);
+	}
+	Subsystem->RegisterSleeping(this);
+}
+
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION == 5
+bool UUHLStateTreeAIComponent::HasTickingActiveNodes()
+{
+	const FStateTreeExecutionState* Exec = InstanceData.GetExecutionState();
+	if (!Exec) return true;
+
+	for (const FStateTreeExecutionFrame& Frame : Exec->ActiveFrames)
+	{
+		if (!Frame.StateTree) return true;
+
+		// evaluators and global tasks tick whenever the tree does
+		const UHLStateTreeAssetUtils::FSleepInfo& Info = FindOrAddSleepInfo(Frame.StateTree);
+		if (Info.bGlobalNeedsTick) return true;
+
+		for (int32 ActiveIndex = 0; ActiveIndex < Frame.ActiveStates.Num(); ++ActiveIndex)
+		{
+			const int32 StateIndex = Frame.ActiveStates[ActiveIndex].Index;
+			if (!Info.StatesNeedingTick.IsValidIndex(StateIndex) || Info.StatesNeedingTick[StateIndex]) return true;
+		}
+	}
+	return false;
+}
+
+void UUHLStateTreeAIComponent::PrebuildSleepInfo()
+{
+	FindOrAddSleepInfo(StateTreeRef.GetStateTree());
+	for (const FStateTreeReferenceOverrideItem& Item : LinkedStateTreeOverrides.GetOverrideItems())
+	{
+		FindOrAddSleepInfo(Item.GetStateTreeReference().GetStateTree());
+	}
+}
+
+const UHLStateTreeAssetUtils::FSleepInfo& UUHLStateTreeAIComponent::FindOrAddSleepInfo(const UStateTree* StateTree)
+{
+	for (const UHLStateTreeAssetUtils::FSleepInfo& Info : SleepInfos)
+	{
+		if (Info.StateTree == StateTree) return Info;
+	}
+	UHLStateTreeAssetUtils::FSleepInfo& Info = SleepInfos.AddDefaulted_GetRef();
+	UHLStateTreeAssetUtils::BuildSleepInfo(StateTree, Info);
+	return Info;
+}
+#endif
+
+bool UUHLStateTreeAIComponent::ShouldWakeUp(double Now) const
+{
+	return Now >= WakeUpTime || InstanceData.GetEventQueue().HasEvents();
+}
+
+void UUHLStateTreeAIComponent::WakeUp()
+{
+	if (!bSleeping) return;
+
+	bSleeping = false;
+	UHLStateTreeTelemetry::AddSleepingAgent(-1);
+	if (UUHLStateTreeSubsystem* Subsystem = UUHLStateTreeSubsystem::Get(GetWorld()))
+	{
+		Subsystem->UnregisterSleeping(this);
+	}
+	// scheduler keeps the last tick time of its agents itself
+	if (!bTickScheduled)
+	{
+		bCatchUpDeltaTime = true;
+		SetComponentTickEnabled(true);
+	}
+}
+
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 6)
+void UUHLStateTreeAIComponent::SetComponentTickEnabled(bool bEnabled)
+{
+	// the subsystem ticks the agent, its own tick would tick the tree a second time
+	if (bEnabled && bTickScheduled) return;
+	Super::SetComponentTickEnabled(bEnabled);
+}
+#endif
+
+void UUHLStateTreeAIComponent::UpdateSignificance(const TArray<FVector>& ViewLocations, double Now)
+{
+	if (!SignificanceEvaluator) return;
+
+	Significance = SignificanceEvaluator->EvaluateSignificance(this, ViewLocations);
+	SetTickRate(SignificanceEvaluator->SelectTickRate(Significance, TickRate, DemotionStartTime, Now));
+}
+
+float UUHLStateTreeAIComponent::GetTickRateInterval() const
+{
+	return SignificanceEvaluator ? SignificanceEvaluator->GetTickRateInterval(TickRate) : 0.0f;
+}
+
+void UUHLStateTreeAIComponent::SetTickRate(EUHLStateTreeTickRate NewRate)
+{
+	if (TickRate == NewRate) return;
+
+	TickRate = NewRate;
+	// scheduler reads the interval itself, pending immediate tick restores it after ticking
+	if (!bTickScheduled && !bImmediateTickRequested)
+	{
+		SetComponentTickInterval(GetTickRateInterval());
+	}
+}
+
+void UUHLStateTreeAIComponent::RequestImmediateTick()
+{
+	WakeUp();
+	if (bImmediateTickRequested || GetTickRateInterval() <= 0.0f) return;
+
+	bImmediateTickRequested = true;
+	if (!bTickScheduled)
+	{
+		SetComponentTickIntervalAndCooldown(0.0f);
+	}
+}
+
+void UUHLStateTreeAIComponent::RegisterTickScheduling()
+{
+	// Super::StartLogic may have failed to start the tree
+	UUHLStateTreeSubsystem* Subsystem = UUHLStateTreeSubsystem::Get(GetWorld());
+	if (!Subsystem || !IsRunning()) return;
+
+	if (SignificanceEvaluator)
+	{
+		Subsystem->RegisterSignificance(this);
+	}
+	if (bAllowParallelTick && UHLStateTreeParallel::IsTreeThreadSafe(StateTreeRef.GetStateTree(), &LinkedStateTreeOverrides))
+	{
+		Subsystem->RegisterParallelComponent(this);
+		bTickScheduled = true;
+		SetComponentTickInterval(0.0f);
+	}
+	else if (UUHLStateTreeSubsystem::IsSchedulingEnabled())
+	{
+		Subsystem->RegisterComponent(this, TickPriority);
+		bTickScheduled = true;
+		SetComponentTickInterval(0.0f);
+	}
+}
+
+void UUHLStateTreeAIComponent::UnregisterTickScheduling()
+{
+	WakeUp();
+
+	// cleared first, the subsystem turns the component's own tick back on when unregistering
+	const bool bWasTickScheduled = bTickScheduled;
+	bTickScheduled = false;
+	if (UUHLStateTreeSubsystem* Subsystem = UUHLStateTreeSubsystem::Get(GetWorld()))
+	{
+		Subsystem->UnregisterSignificance(this);
+		Subsystem->UnregisterComponent(this);
+	}
+	if (bWasTickScheduled)
+	{
+		SetComponentTickInterval(GetTickRateInterval());
+	}
+}
+
+void UUHLStateTreeAIComponent::RegisterFocusRotation()
+{
+	if (!bUseBatchedFocusRotation || !AIOwner) return;
+	if (UUHLFocusRotationSubsystem* Subsystem = UUHLFocusRotationSubsystem::Get(GetWorld()))
+	{
+		Subsystem->RegisterController(AIOwner, FocusRotationInterpSpeed);
+	}
+}
+
+void UUHLStateTreeAIComponent::UnregisterFocusRotation()
+{
+	if (!bUseBatchedFocusRotation || !AIOwner) return;
+	if (UUHLFocusRotationSubsystem* Subsystem = UUHLFocusRotationSubsystem::Get(GetWorld()))
+	{
+		Subsystem->UnregisterController(AIOwner);
+	}
+}
+
+void UUHLStateTreeAIComponent::RequestMontagePreload()
+{
+	TArray<FSoftObjectPath> Paths;
+	UHLStateTreeAssetUtils::CollectSoftMontages(StateTreeRef.GetStateTree(), Paths);
+	for (const FStateTreeReferenceOverrideItem& Item : LinkedStateTreeOverrides.GetOverrideItems())
+	{
+		UHLStateTreeAssetUtils::CollectSoftMontages(Item.GetStateTreeReference().GetStateTree(), Paths);
+	}
+
+	// request the new set before releasing the old one, so montages shared by both trees stay resident
+	TSharedPtr<FStreamableHandle> PreviousHandle = MoveTemp(MontagePreloadHandle);
+	if (Paths.Num() > 0)
+	{
+		MontagePreloadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+			MoveTemp(Paths),
+			FStreamableDelegate::CreateWeakLambda(this, [this]()
+			{
+				// loaded soft montages can be sent by table index too
+				PrebuildMontageTable();
+			}),
+			FStreamableManager::AsyncLoadHighPriority);
+	}
+
+	if (PreviousHandle.IsValid())
+	{
+		PreviousHandle->ReleaseHandle();
+	}
+}
+
+void UUHLStateTreeAIComponent::ReleaseMontagePreload()
+{
+	if (MontagePreloadHandle.IsValid())
+	{
+		MontagePreloadHandle->ReleaseHandle();
+		MontagePreloadHandle.Reset();
+	}
+}
+
+UUHLMontageReplicatorObject* UUHLStateTreeAIComponent::GetMontageReplicator(AActor* Actor)
+{
+	checkSlow(!UHLStateTreeParallel::IsInParallelTick());
+	UUHLMontageReplicatorObject* Replicator = MontageReplicator.Get();
+	if (Replicator && Replicator->GetOuter() == Actor)
+	{
+		return Replicator;
+	}
+
+	Replicator = UUHLMontageReplicatorObject::GetOrCreate(Actor);
+	MontageReplicator = Replicator;
+	return Replicator;
+}
+
+void UUHLStateTreeAIComponent::PrebuildMontageTable()
+{
+	APawn* Pawn = AIOwner ? AIOwner->GetPawn() : nullptr;
+	if (!Pawn || !Pawn->HasAuthority() || !Pawn->GetIsReplicated()) return;
+
+	TArray<UAnimMontage*> Montages;
+	UHLStateTreeAssetUtils::CollectMontages(StateTreeRef.GetStateTree(), Montages);
+	for (const FStateTreeReferenceOverrideItem& Item : LinkedStateTreeOverrides.GetOverrideItems())
+	{
+		UHLStateTreeAssetUtils::CollectMontages(Item.GetStateTreeReference().GetStateTree(), Montages);
+	}
+
+	if (Montages.Num() > 0)
+	{
+		if (UUHLMontageReplicatorObject* Replicator = GetMontageReplicator(Pawn))
+		{
+			Replicator->RegisterMontages(Montages);
+		}
+	}
+}
+
+void UUHLStateTreeAIComponent::InvalidateContextCache()
+{
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION == 5
+	ExternalDataCache.Reset();
+	ExternalDataPawn.Reset();
+	SleepInfos.Reset();
+#endif
 }
 
 #if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION == 5
@@ -24,6 +714,53 @@ bool UUHLStateTreeAIComponent::SetContextRequirements(
 	FStateTreeExecutionContext& Context, bool bLogErrors)
 {
 	Context.SetLinkedStateTreeOverrides(&LinkedStateTreeOverrides);
-	return Super::SetContextRequirements(Context, bLogErrors);
+	if (!Super::SetContextRequirements(Context, bLogErrors)) return false;
+
+	// Super's callback looks up every external data on each new context, i.e. every tick
+	Context.SetCollectExternalDataCallback(FOnCollectStateTreeExternalData::CreateUObject(this, &UUHLStateTreeAIComponent::CollectExternalDataCached));
+	return true;
+}
+
+bool UUHLStateTreeAIComponent::CollectExternalDataCached(const FStateTreeExecutionContext& Context, const UStateTree* StateTree, TArrayView<const FStateTreeExternalDataDesc> ExternalDataDescs, TArrayView<FStateTreeDataView> OutDataViews) const
+{
+	const APawn* Pawn = AIOwner ? AIOwner->GetPawn() : nullptr;
+	if (Pawn != ExternalDataPawn.Get())
+	{
+		ExternalDataCache.Reset();
+		ExternalDataPawn = Pawn;
+	}
+
+	const int32 EntryIndex = ExternalDataCache.IndexOfByPredicate([StateTree](const FExternalDataCacheEntry& Entry) { return Entry.StateTree == StateTree; });
+	if (EntryIndex != INDEX_NONE)
+	{
+		const FExternalDataCacheEntry& Entry = ExternalDataCache[EntryIndex];
+		const bool bObjectsValid = !Entry.Objects.ContainsByPredicate([](const TWeakObjectPtr<const UObject>& Object) { return !Object.IsValid(); });
+		if (bObjectsValid && Entry.DataViews.Num() == OutDataViews.Num())
+		{
+			for (int32 Index = 0; Index < OutDataViews.Num(); Index++)
+			{
+				OutDataViews[Index] = Entry.DataViews[Index];
+			}
+			return true;
+		}
+		ExternalDataCache.RemoveAtSwap(EntryIndex);
+	}
+
+	if (!UStateTreeAIComponentSchema::CollectExternalData(Context, StateTree, ExternalDataDescs, OutDataViews))
+	{
+		return false;
+	}
+
+	FExternalDataCacheEntry& Entry = ExternalDataCache.AddDefaulted_GetRef();
+	Entry.StateTree = StateTree;
+	Entry.DataViews = OutDataViews;
+	for (const FStateTreeDataView& DataView : OutDataViews)
+	{
+		if (DataView.GetStruct() && DataView.GetStruct()->IsA<UClass>() && DataView.GetMemory())
+		{
+			Entry.Objects.Add(reinterpret_cast<const UObject*>(DataView.GetMemory()));
+		}
+	}
+	return true;
 }
 #endif
@@ -5,6 +5,7 @@
 #include "StateTreeExecutionContext.h"
 #include "StateTreeNodeDescriptionHelpers.h"
 #include "DrawDebugHelpers.h"
+#include "Core/UHLStateTreeProfiling.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(UHLSTCondition_InAngle)
 
@@ -48,8 +49,12 @@ namespace
 
 bool FUHLSTCondition_InAngle::TestCondition(FStateTreeExecutionContext& Context) const
 {
-	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+	UHL_STATETREE_NODE_SCOPE(InAngle);
+	return UHLNodeScope.Result(Context.GetOwner(), Evaluate(Context.GetInstanceData(*this)));
+}
 
+bool FUHLSTCondition_InAngle::Evaluate(const FInstanceDataType& InstanceData)
+{
 	if (!IsValid(InstanceData.Character))
 	{
 		return false;
@@ -86,7 +91,9 @@ bool FUHLSTCondition_InAngle::TestCondition(FStateTreeExecutionContext& Context)
 
 	const bool bFinal = InstanceData.bInverse ? !bInAny : bInAny;
 
-	if (InstanceData.bDebug && InstanceData.DebugDuration > 0.0f)
+#if UHL_STATETREE_WITH_COSMETICS
+	// debug draws aren't thread-safe, skipped when the tree ticks on a worker
+	if (InstanceData.bDebug && InstanceData.DebugDuration > 0.0f && IsInGameThread())
 	{
 		if (UWorld* World = InstanceData.Character->GetWorld())
 		{
@@ -117,6 +124,7 @@ bool FUHLSTCondition_InAngle::TestCondition(FStateTreeExecutionContext& Context)
 			DrawDebugString(World, SelfLocation + FVector(0, 0, 120.0f), Msg, nullptr, Col, InstanceData.DebugDuration, true);
 		}
 	}
+#endif
 
 	return bFinal;
 }
@@ -7,6 +7,7 @@
 #include "Components/CapsuleComponent.h"
 #include "Internationalization/Internationalization.h"
 #include "DrawDebugHelpers.h"
+#include "Core/UHLStateTreeProfiling.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(UHLSTCondition_InRange)
 
@@ -36,8 +37,12 @@ namespace {
 
 bool FUHLSTCondition_InRange::TestCondition(FStateTreeExecutionContext& Context) const
 {
-	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+	UHL_STATETREE_NODE_SCOPE(InRange);
+	return UHLNodeScope.Result(Context.GetOwner(), Evaluate(Context.GetInstanceData(*this)));
+}
 
+bool FUHLSTCondition_InRange::Evaluate(const FInstanceDataType& InstanceData)
+{
 	if (!IsValid(InstanceData.Character))
 	{
 		return false;
@@ -84,8 +89,9 @@ bool FUHLSTCondition_InRange::TestCondition(FStateTreeExecutionContext& Context)
 
 	const bool bFinal = InstanceData.bInverse ? !bInRange : bInRange;
 
-	// Debug visualization
-	if (InstanceData.bDebug && InstanceData.DebugDuration > 0.0f)
+#if UHL_STATETREE_WITH_COSMETICS
+	// Debug visualization, draws aren't thread-safe so skipped when the tree ticks on a worker
+	if (InstanceData.bDebug && InstanceData.DebugDuration > 0.0f && IsInGameThread())
 	{
 		UWorld* World = InstanceData.Character->GetWorld();
 		if (World)
@@ -150,6 +156,7 @@ bool FUHLSTCondition_InRange::TestCondition(FStateTreeExecutionContext& Context)
 			DrawDebugSphere(World, End, 6.0f, 8, LineColor, false, InstanceData.DebugDuration, 0, 1.0f);
 		}
 	}
+#endif
 
 	return bFinal;
 }
@@ -6,6 +6,7 @@
 #include "StateTreeExecutionContext.h"
 #include "StateTreeNodeDescriptionHelpers.h"
 #include "Components/UHLStateTreeAIComponent.h"
+#include "Core/UHLStateTreeProfiling.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(UHLSTCondition_TagCooldown)
 
@@ -13,19 +14,24 @@
 
 bool FUHLSTCondition_TagCooldown::TestCondition(FStateTreeExecutionContext& Context) const
 {
-	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+	UHL_STATETREE_NODE_SCOPE(TagCooldown);
+	return UHLNodeScope.Result(Context.GetOwner(), Evaluate(Context.GetInstanceData(*this), Cast<AAIController>(Context.GetOwner())));
+}
 
-	AAIController* AIController = Cast<AAIController>(Context.GetOwner());
+bool FUHLSTCondition_TagCooldown::Evaluate(const FInstanceDataType& InstanceData, const AAIController* AIController)
+{
 	if (!AIController) return false;
 	
-	if (UUHLStateTreeAIComponent* Cmp = Cast<UUHLStateTreeAIComponent>(AIController->GetBrainComponent()))
+	if (const UUHLStateTreeAIComponent* Cmp = Cast<UUHLStateTreeAIComponent>(AIController->GetBrainComponent()))
 	{
-		bool bResult = Cmp->TagCooldowns.HasCooldownFinished(Context.GetOwner(), InstanceData.CooldownTag);
+		bool bResult = Cmp->TagCooldowns.HasCooldownFinished(AIController, InstanceData.CooldownTag);
 		return InstanceData.bInverse ? !bResult : bResult;
 	}
 	else
 	{
+#if UHL_STATETREE_WITH_COSMETICS
 		GEngine->AddOnScreenDebugMessage(-1, 5, FColor::Red, TEXT("[UHLStateTreeSetCooldownTask] using UUHLStateTreeAIComponent required to use SetCooldownTask"));
+#endif
 	}
 	
 	return false;
@@ -0,0 +1,192 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLFocusArbiter.h"
+
+#include "AIController.h"
+#include "Components/UHLStateTreeAIComponent.h"
+#include "Core/UHLStateTreeMemory.h"
+#include <atomic>
+
+bool FUHLFocusRequest::IsSameTarget(const FUHLFocusRequest& Other) const
+{
+	if (Actor.Get() != Other.Actor.Get()) return false;
+	if (Actor.IsValid()) return true;
+	return Location.Equals(Other.Location, KINDA_SMALL_NUMBER);
+}
+
+FUHLFocusArbiter::FSlot& FUHLFocusArbiter::GetSlot(uint8 FocusSlot)
+{
+	if (!Slots.IsValidIndex(FocusSlot))
+	{
+		Slots.SetNum(FocusSlot + 1);
+	}
+	return Slots[FocusSlot];
+}
+
+void FUHLFocusArbiter::MarkDirty(FSlot& Slot)
+{
+	Slot.bDirty = true;
+	bAnyDirty = true;
+}
+
+void FUHLFocusArbiter::SubmitRequest(const void* Owner, uint8 FocusSlot, const FUHLFocusRequest& Request)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree);
+	FSlot& Slot = GetSlot(FocusSlot);
+	FOwnedRequest* Existing = Slot.Requests.FindByPredicate([Owner](const FOwnedRequest& Item) { return Item.Owner == Owner; });
+	if (Existing)
+	{
+		if (Existing->Request.Priority == Request.Priority && Existing->Request.IsSameTarget(Request)) return;
+	}
+	else
+	{
+		Existing = &Slot.Requests.AddDefaulted_GetRef();
+		Existing->Owner = Owner;
+	}
+	Existing->Request = Request;
+	Existing->Serial = ++NextSerial;
+	MarkDirty(Slot);
+}
+
+void FUHLFocusArbiter::ReleaseRequest(const void* Owner, uint8 FocusSlot)
+{
+	if (!Slots.IsValidIndex(FocusSlot)) return;
+
+	FSlot& Slot = Slots[FocusSlot];
+	if (Slot.Requests.RemoveAllSwap([Owner](const FOwnedRequest& Item) { return Item.Owner == Owner; }) > 0)
+	{
+		MarkDirty(Slot);
+	}
+}
+
+void FUHLFocusArbiter::ClearRequests(uint8 FocusSlot, int32 MaxPriority)
+{
+	FSlot& Slot = GetSlot(FocusSlot);
+	Slot.Requests.RemoveAllSwap([MaxPriority](const FOwnedRequest& Item) { return Item.Request.Priority <= MaxPriority; });
+	Slot.bForceClear = true;
+	MarkDirty(Slot);
+}
+
+void FUHLFocusArbiter::Resolve(AAIController* Controller)
+{
+	if (!bAnyDirty || !Controller) return;
+	bAnyDirty = false;
+
+	for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); ++SlotIndex)
+	{
+		FSlot& Slot = Slots[SlotIndex];
+		if (!Slot.bDirty) continue;
+		Slot.bDirty = false;
+
+		const FOwnedRequest* Best = nullptr;
+		for (const FOwnedRequest& Item : Slot.Requests)
+		{
+			if (!Best
+				|| Item.Request.Priority > Best->Request.Priority
+				|| (Item.Request.Priority == Best->Request.Priority && Item.Serial > Best->Serial))
+			{
+				Best = &Item;
+			}
+		}
+
+		const FUHLFocusRequest Resolved = Best ? Best->Request : FUHLFocusRequest();
+		if (Resolved.IsClear())
+		{
+			if (Slot.bForceClear || (Slot.Applied.IsSet() && !Slot.Applied->IsClear()))
+			{
+				Controller->ClearFocus(static_cast<uint8>(SlotIndex));
+			}
+			// with no requests left the slot is free for code outside the arbiter
+			Slot.Applied = Best ? TOptional<FUHLFocusRequest>(Resolved) : TOptional<FUHLFocusRequest>();
+		}
+		else if (!Slot.Applied.IsSet() || !Slot.Applied->IsSameTarget(Resolved))
+		{
+			if (AActor* Actor = Resolved.Actor.Get())
+			{
+				Controller->SetFocus(Actor, static_cast<uint8>(SlotIndex));
+			}
+			else
+			{
+				Controller->SetFocalPoint(Resolved.Location, static_cast<uint8>(SlotIndex));
+			}
+			Slot.Applied = Resolved;
+		}
+		Slot.bForceClear = false;
+	}
+}
+
+void FUHLFocusArbiter::Reset(AAIController* Controller)
+{
+	for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); ++SlotIndex)
+	{
+		const FSlot& Slot = Slots[SlotIndex];
+		if (Controller && Slot.Applied.IsSet() && !Slot.Applied->IsClear())
+		{
+			Controller->ClearFocus(static_cast<uint8>(SlotIndex));
+		}
+	}
+	Slots.Reset();
+	bAnyDirty = false;
+}
+
+namespace UHLFocus
+{
+	FUHLFocusArbiter* FindArbiter(const AAIController* Controller)
+	{
+		UUHLStateTreeAIComponent* Cmp = UUHLStateTreeAIComponent::FindForController(Controller);
+		return Cmp ? &Cmp->GetFocusArbiter() : nullptr;
+	}
+
+	const void* MakeOwnerKey()
+	{
+		// keys are never dereferenced, small integers don't collide with addresses of other owners
+		static std::atomic<UPTRINT> NextKey = 1;
+		return reinterpret_cast<const void*>(NextKey.fetch_add(1, std::memory_order_relaxed));
+	}
+
+	void SetFocus(AAIController* Controller, const void* Owner, AActor* Actor, uint8 FocusSlot, int32 Priority)
+	{
+		if (!Controller) return;
+		if (FUHLFocusArbiter* Arbiter = FindArbiter(Controller))
+		{
+			FUHLFocusRequest Request;
+			Request.Actor = Actor;
+			Request.Priority = Priority;
+			Arbiter->SubmitRequest(Owner, FocusSlot, Request);
+		}
+		else if (Controller->GetFocusActorForPriority(FocusSlot) != Actor)
+		{
+			Controller->SetFocus(Actor, FocusSlot);
+		}
+	}
+
+	void SetFocalPoint(AAIController* Controller, const void* Owner, const FVector& Location, uint8 FocusSlot, int32 Priority)
+	{
+		if (!Controller) return;
+		if (FUHLFocusArbiter* Arbiter = FindArbiter(Controller))
+		{
+			FUHLFocusRequest Request;
+			Request.Location = Location;
+			Request.Priority = Priority;
+			Arbiter->SubmitRequest(Owner, FocusSlot, Request);
+		}
+		else if (Controller->GetFocusActorForPriority(FocusSlot) != nullptr
+			|| !Controller->GetFocalPointForPriority(FocusSlot).Equals(Location, KINDA_SMALL_NUMBER))
+		{
+			Controller->SetFocalPoint(Location, FocusSlot);
+		}
+	}
+
+	void ReleaseFocus(AAIController* Controller, const void* Owner, uint8 FocusSlot)
+	{
+		if (!Controller) return;
+		if (FUHLFocusArbiter* Arbiter = FindArbiter(Controller))
+		{
+			Arbiter->ReleaseRequest(Owner, FocusSlot);
+		}
+		else
+		{
+			Controller->ClearFocus(FocusSlot);
+		}
+	}
+}
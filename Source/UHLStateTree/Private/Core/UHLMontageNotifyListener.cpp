@@ -0,0 +1,59 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLMontageNotifyListener.h"
+
+#include "Animation/AnimInstance.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLMontageNotifyListener)
+
+void UUHLMontageNotifyListener::Bind(UAnimInstance* InAnimInstance, int32 InMontageInstanceID, TConstArrayView<FUHLSTMontageNotifyEvent> InEvents, const FStateTreeWeakExecutionContext& InWeakContext)
+{
+	Unbind();
+	if (!InAnimInstance || InMontageInstanceID == INDEX_NONE) return;
+
+	AnimInstance = InAnimInstance;
+	MontageInstanceID = InMontageInstanceID;
+	Events = InEvents;
+	WeakContext = InWeakContext;
+
+	InAnimInstance->OnPlayMontageNotifyBegin.AddUniqueDynamic(this, &UUHLMontageNotifyListener::OnNotifyBegin);
+	InAnimInstance->OnPlayMontageNotifyEnd.AddUniqueDynamic(this, &UUHLMontageNotifyListener::OnNotifyEnd);
+}
+
+void UUHLMontageNotifyListener::Unbind()
+{
+	if (UAnimInstance* BoundAnimInstance = AnimInstance.Get())
+	{
+		BoundAnimInstance->OnPlayMontageNotifyBegin.RemoveDynamic(this, &UUHLMontageNotifyListener::OnNotifyBegin);
+		BoundAnimInstance->OnPlayMontageNotifyEnd.RemoveDynamic(this, &UUHLMontageNotifyListener::OnNotifyEnd);
+	}
+	AnimInstance.Reset();
+	MontageInstanceID = INDEX_NONE;
+	WeakContext = FStateTreeWeakExecutionContext();
+}
+
+void UUHLMontageNotifyListener::OnNotifyBegin(FName NotifyName, const FBranchingPointNotifyPayload& BranchingPointPayload)
+{
+	if (BranchingPointPayload.MontageInstanceID != MontageInstanceID) return;
+
+	for (const FUHLSTMontageNotifyEvent& Event : Events)
+	{
+		if (Event.NotifyName == NotifyName && Event.BeginEventTag.IsValid())
+		{
+			WeakContext.SendEvent(Event.BeginEventTag);
+		}
+	}
+}
+
+void UUHLMontageNotifyListener::OnNotifyEnd(FName NotifyName, const FBranchingPointNotifyPayload& BranchingPointPayload)
+{
+	if (BranchingPointPayload.MontageInstanceID != MontageInstanceID) return;
+
+	for (const FUHLSTMontageNotifyEvent& Event : Events)
+	{
+		if (Event.NotifyName == NotifyName && Event.EndEventTag.IsValid())
+		{
+			WeakContext.SendEvent(Event.EndEventTag);
+		}
+	}
+}
@@ -0,0 +1,13 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeAIController.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLStateTreeAIController)
+
+void AUHLStateTreeAIController::UpdateControlRotation(float DeltaTime, bool bUpdatePawn)
+{
+	// already updated by UUHLFocusRotationSubsystem before the pawn's movement this frame
+	if (bBatchedFocusRotation) return;
+
+	Super::UpdateControlRotation(DeltaTime, bUpdatePawn);
+}
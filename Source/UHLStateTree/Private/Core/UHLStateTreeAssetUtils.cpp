@@ -0,0 +1,98 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeAssetUtils.h"
+
+#include "StateTree.h"
+#include "StateTreeEvaluatorBase.h"
+#include "StateTreeInstanceData.h"
+#include "StateTreeTaskBase.h"
+#include "Tasks/UHLSTTask_PlayAnimMontage.h"
+
+static bool UHL_TaskNeedsTick(const FConstStructView Node)
+{
+	static const FName PackageName(TEXT("/Script/UHLStateTree"));
+	const FStateTreeTaskBase* Task = Node.GetPtr<const FStateTreeTaskBase>();
+	if (!Task) return false;
+	return Task->bShouldCallTick || Node.GetScriptStruct()->GetOutermost()->GetFName() != PackageName;
+}
+
+void UHLStateTreeAssetUtils::BuildSleepInfo(const UStateTree* StateTree, FSleepInfo& OutInfo)
+{
+	OutInfo.StateTree = StateTree;
+	OutInfo.bGlobalNeedsTick = false;
+	OutInfo.StatesNeedingTick.Reset();
+	if (!StateTree) return;
+
+	const FInstancedStructContainer& Nodes = StateTree->GetNodes();
+	const TConstArrayView<FCompactStateTreeState> States = StateTree->GetStates();
+
+	// global tasks are outside every state's task range
+	TBitArray<> StateTasks(false, Nodes.Num());
+	OutInfo.StatesNeedingTick.Init(false, States.Num());
+	for (int32 StateIndex = 0; StateIndex < States.Num(); ++StateIndex)
+	{
+		const FCompactStateTreeState& State = States[StateIndex];
+		for (int32 Index = State.TasksBegin; Index < State.TasksBegin + State.TasksNum; ++Index)
+		{
+			StateTasks[Index] = true;
+			if (UHL_TaskNeedsTick(Nodes[Index]))
+			{
+				OutInfo.StatesNeedingTick[StateIndex] = true;
+			}
+		}
+		for (int32 Index = State.TransitionsBegin; Index < State.TransitionsBegin + State.TransitionsNum; ++Index)
+		{
+			const FCompactStateTransition* Transition = StateTree->GetTransitionFromIndex(FStateTreeIndex16(Index));
+			if (Transition && (Transition->Trigger == EStateTreeTransitionTrigger::OnTick || Transition->HasDelay()))
+			{
+				OutInfo.StatesNeedingTick[StateIndex] = true;
+			}
+		}
+	}
+
+	for (int32 Index = 0; Index < Nodes.Num() && !OutInfo.bGlobalNeedsTick; ++Index)
+	{
+		if (StateTasks[Index]) continue;
+		OutInfo.bGlobalNeedsTick = Nodes[Index].GetPtr<const FStateTreeEvaluatorBase>() != nullptr || UHL_TaskNeedsTick(Nodes[Index]);
+	}
+}
+
+void UHLStateTreeAssetUtils::CollectMontages(const UStateTree* StateTree, TArray<UAnimMontage*>& OutMontages)
+{
+	if (!StateTree) return;
+
+	const FStateTreeInstanceData& DefaultInstanceData = StateTree->GetDefaultInstanceData();
+	for (int32 Index = 0; Index < DefaultInstanceData.Num(); Index++)
+	{
+		const FConstStructView InstanceView = DefaultInstanceData.GetStruct(Index);
+		if (const FUHLSTTask_PlayAnimMontageInstanceData* MontageData = InstanceView.GetPtr<const FUHLSTTask_PlayAnimMontageInstanceData>())
+		{
+			if (MontageData->AnimMontage)
+			{
+				OutMontages.AddUnique(MontageData->AnimMontage);
+			}
+			else if (UAnimMontage* LoadedMontage = MontageData->SoftAnimMontage.Get())
+			{
+				OutMontages.AddUnique(LoadedMontage);
+			}
+		}
+	}
+}
+
+void UHLStateTreeAssetUtils::CollectSoftMontages(const UStateTree* StateTree, TArray<FSoftObjectPath>& OutPaths)
+{
+	if (!StateTree) return;
+
+	const FStateTreeInstanceData& DefaultInstanceData = StateTree->GetDefaultInstanceData();
+	for (int32 Index = 0; Index < DefaultInstanceData.Num(); Index++)
+	{
+		const FConstStructView InstanceView = DefaultInstanceData.GetStruct(Index);
+		if (const FUHLSTTask_PlayAnimMontageInstanceData* MontageData = InstanceView.GetPtr<const FUHLSTTask_PlayAnimMontageInstanceData>())
+		{
+			if (!MontageData->AnimMontage && !MontageData->SoftAnimMontage.IsNull())
+			{
+				OutPaths.AddUnique(MontageData->SoftAnimMontage.ToSoftObjectPath());
+			}
+		}
+	}
+}
@@ -0,0 +1,423 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeBenchmark.h"
+
+#include "AIController.h"
+#include "Dom/JsonObject.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/UObjectHash.h"
+#include "UHLStateTree.h"
+#include "Core/UHLStateTreeProfiling.h"
+#include "Net/UHLMontageReplicatorObject.h"
+#include "Subsystems/UHLStateTreeSubsystem.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLStateTreeBenchmark)
+
+TWeakObjectPtr<UUHLStateTreeBenchmark> UUHLStateTreeBenchmark::Running;
+
+namespace UHLStateTreeBenchmark
+{
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("uhl.StateTree.Benchmark"),
+		TEXT("Benchmarks UHL StateTree agents. Pawn=<class path> [Agents=100,1000,5000] [Warmup=60] [Frames=600] [Spacing=300]\n")
+		TEXT("[Output=<name>] [Baseline=<json path>] [Threshold=<percent>] [-Quit]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const FString Params = FString::Join(Args, TEXT(" "));
+
+			UUHLStateTreeBenchmark::FSettings Settings;
+			FString PawnPath;
+			FParse::Value(*Params, TEXT("Pawn="), PawnPath);
+			Settings.PawnClass = TSoftClassPtr<APawn>(FSoftObjectPath(PawnPath));
+
+			FString AgentCounts;
+			if (FParse::Value(*Params, TEXT("Agents="), AgentCounts, false))
+			{
+				TArray<FString> Counts;
+				AgentCounts.ParseIntoArray(Counts, TEXT(","));
+				Settings.AgentCounts.Reset();
+				for (const FString& Count : Counts)
+				{
+					Settings.AgentCounts.Add(FMath::Max(1, FCString::Atoi(*Count)));
+				}
+			}
+			FParse::Value(*Params, TEXT("Warmup="), Settings.WarmupFrames);
+			FParse::Value(*Params, TEXT("Frames="), Settings.Frames);
+			FParse::Value(*Params, TEXT("Spacing="), Settings.Spacing);
+			FParse::Value(*Params, TEXT("Output="), Settings.OutputName);
+			FParse::Value(*Params, TEXT("Baseline="), Settings.BaselinePath);
+			FParse::Value(*Params, TEXT("Threshold="), Settings.RegressionPercent);
+			Settings.bQuitWhenDone = FParse::Param(*Params, TEXT("Quit"));
+
+			UUHLStateTreeBenchmark::Start(World, Settings);
+		}));
+
+	static double CyclesToMs(uint64 Cycles)
+	{
+		return FPlatformTime::ToMilliseconds64(Cycles);
+	}
+
+	static double GetUsedMemoryMB(uint64 Bytes)
+	{
+		return static_cast<double>(Bytes) / (1024.0 * 1024.0);
+	}
+
+	static FString GetNetMode(const UWorld* World)
+	{
+		const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (!NetDriver) return TEXT("Standalone");
+#if UE_WITH_IRIS
+		if (NetDriver->IsUsingIrisReplication()) return TEXT("Iris");
+#endif
+		return TEXT("Legacy");
+	}
+}
+
+UUHLStateTreeBenchmark* UUHLStateTreeBenchmark::Start(UWorld* World, const FSettings& InSettings)
+{
+	if (!World || Running.IsValid())
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("StateTree benchmark needs a game world and can't run twice"));
+		return nullptr;
+	}
+
+	TSubclassOf<APawn> PawnClass = InSettings.PawnClass.LoadSynchronous();
+	if (!PawnClass || InSettings.AgentCounts.Num() == 0)
+	{
+		UE_LOG(LogUHLStateTree, Error, TEXT("StateTree benchmark: can't load pawn class '%s'"), *InSettings.PawnClass.ToString());
+		return nullptr;
+	}
+
+	UUHLStateTreeBenchmark* Benchmark = NewObject<UUHLStateTreeBenchmark>();
+	Benchmark->AddToRoot();
+	Benchmark->Settings = InSettings;
+	Benchmark->Settings.Frames = FMath::Max(1, Benchmark->Settings.Frames);
+	Benchmark->Settings.WarmupFrames = FMath::Max(0, Benchmark->Settings.WarmupFrames);
+	if (Benchmark->Settings.OutputName.IsEmpty())
+	{
+		Benchmark->Settings.OutputName = FString::Printf(TEXT("Benchmark-%s"), *FDateTime::Now().ToString());
+	}
+	Benchmark->World = World;
+	Benchmark->PawnClass = PawnClass;
+	Benchmark->TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(Benchmark, &UUHLStateTreeBenchmark::Tick));
+	Benchmark->PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(Benchmark, &UUHLStateTreeBenchmark::OnWorldPostActorTick);
+	Benchmark->TickEndHandle = FWorldDelegates::OnWorldTickEnd.AddUObject(Benchmark, &UUHLStateTreeBenchmark::OnWorldTickEnd);
+	Running = Benchmark;
+
+	Benchmark->BeginRun();
+	return Benchmark;
+}
+
+void UUHLStateTreeBenchmark::BeginRun()
+{
+	RunFrame = 0;
+	FrameMsSum = 0.0;
+	FrameMsMax = 0.0;
+	GameThreadMsSum = 0.0;
+	SchedulerMsSum = 0.0;
+	NetFlushMsSum = 0.0;
+	ConnectionsSum = 0;
+
+	UsedMemoryBeforeSpawn = FPlatformMemory::GetStats().UsedPhysical;
+	SpawnAgents(Settings.AgentCounts[RunIndex]);
+	UE_LOG(LogUHLStateTree, Display, TEXT("StateTree benchmark: %d agents, %d warmup and %d measured frames"),
+		Agents.Num(), Settings.WarmupFrames, Settings.Frames);
+}
+
+bool UUHLStateTreeBenchmark::Tick(float DeltaTime)
+{
+	if (!World.IsValid())
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("StateTree benchmark: world went away"));
+		Finish();
+		return false;
+	}
+
+	if (RunFrame == Settings.WarmupFrames)
+	{
+		UsedMemoryAfterWarmup = FPlatformMemory::GetStats().UsedPhysical;
+		ReplicatorsAfterWarmup = CountMontageReplicators();
+		UHLStateTreeProfiling::ResetNodeTimings();
+		UHLStateTreeProfiling::BeginCapture();
+	}
+	else if (RunFrame > Settings.WarmupFrames)
+	{
+		// DeltaTime and game thread time describe the frame that just finished
+		const double FrameMs = DeltaTime * 1000.0;
+		FrameMsSum += FrameMs;
+		FrameMsMax = FMath::Max(FrameMsMax, FrameMs);
+		GameThreadMsSum += FPlatformTime::ToMilliseconds(GGameThreadTime);
+		if (const UUHLStateTreeSubsystem* Subsystem = UUHLStateTreeSubsystem::Get(World.Get()))
+		{
+			SchedulerMsSum += Subsystem->GetTickStats().UsedMs;
+		}
+		if (const UNetDriver* NetDriver = World->GetNetDriver())
+		{
+			NetFlushMsSum += LastNetFlushMs;
+			ConnectionsSum += NetDriver->ClientConnections.Num();
+		}
+	}
+	RunFrame++;
+
+	if (RunFrame <= Settings.WarmupFrames + Settings.Frames) return true;
+
+	FinishRun();
+	if (++RunIndex < Settings.AgentCounts.Num())
+	{
+		BeginRun();
+		return true;
+	}
+
+	Finish();
+	return false;
+}
+
+void UUHLStateTreeBenchmark::OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == World.Get())
+	{
+		NetFlushStartCycles = FPlatformTime::Cycles64();
+	}
+}
+
+void UUHLStateTreeBenchmark::OnWorldTickEnd(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == World.Get() && NetFlushStartCycles != 0)
+	{
+		LastNetFlushMs = UHLStateTreeBenchmark::CyclesToMs(FPlatformTime::Cycles64() - NetFlushStartCycles);
+		NetFlushStartCycles = 0;
+	}
+}
+
+void UUHLStateTreeBenchmark::FinishRun()
+{
+	using namespace UHLStateTreeBenchmark;
+	UHLStateTreeProfiling::EndCapture();
+
+	const int32 Frames = Settings.Frames;
+	TSharedRef<FJsonObject> Run = MakeShared<FJsonObject>();
+	Run->SetNumberField(TEXT("Agents"), Agents.Num());
+	Run->SetNumberField(TEXT("Frames"), Frames);
+	Run->SetNumberField(TEXT("AvgFrameMs"), FrameMsSum / Frames);
+	Run->SetNumberField(TEXT("MaxFrameMs"), FrameMsMax);
+	Run->SetNumberField(TEXT("AvgGameThreadMs"), GameThreadMsSum / Frames);
+	Run->SetNumberField(TEXT("AvgSchedulerMs"), SchedulerMsSum / Frames);
+
+	const double AvgConnections = static_cast<double>(ConnectionsSum) / Frames;
+	Run->SetNumberField(TEXT("AvgConnections"), AvgConnections);
+	Run->SetNumberField(TEXT("AvgNetFlushMs"), NetFlushMsSum / Frames);
+	Run->SetNumberField(TEXT("NetFlushMsPerConnection"), AvgConnections > 0.0 ? NetFlushMsSum / Frames / AvgConnections : 0.0);
+
+	// soak: montage plays must reuse the replicator of each pawn
+	const int32 Replicators = CountMontageReplicators();
+	Run->SetNumberField(TEXT("MontageReplicatorsAfterWarmup"), ReplicatorsAfterWarmup);
+	Run->SetNumberField(TEXT("MontageReplicators"), Replicators);
+	if (Replicators > ReplicatorsAfterWarmup)
+	{
+		SoakFailures++;
+		UE_LOG(LogUHLStateTree, Error, TEXT("StateTree benchmark: %d agents, montage replicators grew from %d to %d after warmup"),
+			Agents.Num(), ReplicatorsAfterWarmup, Replicators);
+	}
+
+	const uint64 AgentMemory = UsedMemoryAfterWarmup > UsedMemoryBeforeSpawn ? UsedMemoryAfterWarmup - UsedMemoryBeforeSpawn : 0;
+	Run->SetNumberField(TEXT("AgentsMemoryMB"), GetUsedMemoryMB(AgentMemory));
+	Run->SetNumberField(TEXT("MemoryPerAgentKB"), Agents.Num() > 0 ? AgentMemory / 1024.0 / Agents.Num() : 0.0);
+
+	TSharedRef<FJsonObject> Nodes = MakeShared<FJsonObject>();
+	for (int32 Index = 0; Index < static_cast<int32>(UHLStateTreeProfiling::ENode::MAX); Index++)
+	{
+		const UHLStateTreeProfiling::ENode Node = static_cast<UHLStateTreeProfiling::ENode>(Index);
+		const UHLStateTreeProfiling::FNodeTiming Timing = UHLStateTreeProfiling::GetNodeTiming(Node);
+		if (Timing.Calls == 0) continue;
+
+		TSharedRef<FJsonObject> NodeResult = MakeShared<FJsonObject>();
+		NodeResult->SetNumberField(TEXT("CallsPerFrame"), static_cast<double>(Timing.Calls) / Frames);
+		NodeResult->SetNumberField(TEXT("NsPerCall"), CyclesToMs(Timing.Cycles) * 1e6 / Timing.Calls);
+		NodeResult->SetNumberField(TEXT("MsPerFrame"), CyclesToMs(Timing.Cycles) / Frames);
+		Nodes->SetObjectField(UHLStateTreeProfiling::GetNodeName(Node), NodeResult);
+	}
+	Run->SetObjectField(TEXT("Nodes"), Nodes);
+
+	UE_LOG(LogUHLStateTree, Display, TEXT("StateTree benchmark: %d agents, frame %.2f ms (max %.2f), game thread %.2f ms, %.1f KB per agent"),
+		Agents.Num(), FrameMsSum / Frames, FrameMsMax, GameThreadMsSum / Frames, Run->GetNumberField(TEXT("MemoryPerAgentKB")));
+
+	RunResults.Add(MakeShared<FJsonValueObject>(Run));
+	DestroyAgents();
+}
+
+void UUHLStateTreeBenchmark::Finish()
+{
+	UHLStateTreeProfiling::EndCapture();
+	DestroyAgents();
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	FWorldDelegates::OnWorldTickEnd.Remove(TickEndHandle);
+	Running.Reset();
+	RemoveFromRoot();
+
+	TSharedRef<FJsonObject> Results = MakeShared<FJsonObject>();
+	Results->SetStringField(TEXT("Pawn"), Settings.PawnClass.ToString());
+	Results->SetStringField(TEXT("Platform"), FPlatformProperties::IniPlatformName());
+	Results->SetStringField(TEXT("NetMode"), UHLStateTreeBenchmark::GetNetMode(World.Get()));
+	Results->SetArrayField(TEXT("Runs"), RunResults);
+
+	const int32 Regressions = Settings.BaselinePath.IsEmpty() ? 0 : CompareWithBaseline(Results);
+	Results->SetNumberField(TEXT("Regressions"), Regressions);
+	Results->SetNumberField(TEXT("SoakFailures"), SoakFailures);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Results, Writer);
+
+	const FString Path = FPaths::ProfilingDir() / TEXT("UHLStateTree") / Settings.OutputName + TEXT(".json");
+	if (FFileHelper::SaveStringToFile(Json, *Path))
+	{
+		UE_LOG(LogUHLStateTree, Display, TEXT("StateTree benchmark results written to %s"), *Path);
+	}
+	else
+	{
+		UE_LOG(LogUHLStateTree, Error, TEXT("StateTree benchmark: failed to write %s"), *Path);
+	}
+
+	if (Settings.bQuitWhenDone)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, Regressions + SoakFailures > 0 ? 1 : 0);
+	}
+}
+
+void UUHLStateTreeBenchmark::SpawnAgents(int32 Count)
+{
+	UWorld* SpawnWorld = World.Get();
+	if (!SpawnWorld) return;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	const int32 Columns = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count)));
+	Agents.Reserve(Count);
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		const FVector Location((Index % Columns) * Settings.Spacing, (Index / Columns) * Settings.Spacing, 100.0f);
+		APawn* Pawn = SpawnWorld->SpawnActor<APawn>(PawnClass, Location, FRotator::ZeroRotator, SpawnParams);
+		if (!Pawn) continue;
+
+		if (!Pawn->GetController())
+		{
+			Pawn->SpawnDefaultController();
+		}
+		Agents.Add(Pawn);
+	}
+}
+
+int32 UUHLStateTreeBenchmark::CountMontageReplicators() const
+{
+	int32 Count = 0;
+	for (const APawn* Pawn : Agents)
+	{
+		if (!IsValid(Pawn)) continue;
+
+		ForEachObjectWithOuter(Pawn, [&Count](UObject* Object)
+		{
+			Count += Object->IsA<UUHLMontageReplicatorObject>() ? 1 : 0;
+		}, false, RF_ClassDefaultObject, EInternalObjectFlags::Garbage);
+	}
+	return Count;
+}
+
+void UUHLStateTreeBenchmark::DestroyAgents()
+{
+	for (APawn* Pawn : Agents)
+	{
+		if (!IsValid(Pawn)) continue;
+
+		if (AController* Controller = Pawn->GetController())
+		{
+			Controller->Destroy();
+		}
+		Pawn->Destroy();
+	}
+	Agents.Reset();
+}
+
+int32 UUHLStateTreeBenchmark::CompareWithBaseline(const TSharedRef<FJsonObject>& Results) const
+{
+	FString BaselineJson;
+	TSharedPtr<FJsonObject> Baseline;
+	if (!FFileHelper::LoadFileToString(BaselineJson, *Settings.BaselinePath)
+		|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineJson), Baseline) || !Baseline.IsValid())
+	{
+		UE_LOG(LogUHLStateTree, Error, TEXT("StateTree benchmark: can't read baseline %s"), *Settings.BaselinePath);
+		return 0;
+	}
+
+	FString BaselineNetMode;
+	const FString NetMode = Results->GetStringField(TEXT("NetMode"));
+	if (Baseline->TryGetStringField(TEXT("NetMode"), BaselineNetMode) && BaselineNetMode != NetMode)
+	{
+		UE_LOG(LogUHLStateTree, Display, TEXT("StateTree benchmark: comparing %s replication against %s baseline"), *NetMode, *BaselineNetMode);
+	}
+
+	int32 Regressions = 0;
+	const double Limit = 1.0 + Settings.RegressionPercent / 100.0;
+	auto Compare = [&Regressions, Limit](int32 Agents, const FString& Metric, double Value, double BaselineValue)
+	{
+		if (BaselineValue <= 0.0) return;
+
+		const double Change = (Value / BaselineValue - 1.0) * 100.0;
+		if (Value > BaselineValue * Limit)
+		{
+			Regressions++;
+			UE_LOG(LogUHLStateTree, Error, TEXT("StateTree benchmark regression: %d agents %s %.3f -> %.3f (%+.1f%%)"), Agents, *Metric, BaselineValue, Value, Change);
+		}
+		else
+		{
+			UE_LOG(LogUHLStateTree, Display, TEXT("StateTree benchmark: %d agents %s %.3f -> %.3f (%+.1f%%)"), Agents, *Metric, BaselineValue, Value, Change);
+		}
+	};
+
+	const TArray<TSharedPtr<FJsonValue>>& BaselineRuns = Baseline->GetArrayField(TEXT("Runs"));
+	for (const TSharedPtr<FJsonValue>& RunValue : Results->GetArrayField(TEXT("Runs")))
+	{
+		const TSharedPtr<FJsonObject>& Run = RunValue->AsObject();
+		const int32 Agents = static_cast<int32>(Run->GetNumberField(TEXT("Agents")));
+		const TSharedPtr<FJsonValue>* BaselineRunValue = BaselineRuns.FindByPredicate([Agents](const TSharedPtr<FJsonValue>& Value)
+		{
+			return static_cast<int32>(Value->AsObject()->GetNumberField(TEXT("Agents"))) == Agents;
+		});
+		if (!BaselineRunValue) continue;
+
+		const TSharedPtr<FJsonObject>& BaselineRun = (*BaselineRunValue)->AsObject();
+		for (const TCHAR* Metric : { TEXT("AvgFrameMs"), TEXT("AvgGameThreadMs"), TEXT("MemoryPerAgentKB"), TEXT("NetFlushMsPerConnection") })
+		{
+			// baselines of older versions lack newer metrics
+			double BaselineValue = 0.0;
+			if (BaselineRun->TryGetNumberField(Metric, BaselineValue))
+			{
+				Compare(Agents, Metric, Run->GetNumberField(Metric), BaselineValue);
+			}
+		}
+
+		const TSharedPtr<FJsonObject>* BaselineNodes = nullptr;
+		if (!BaselineRun->TryGetObjectField(TEXT("Nodes"), BaselineNodes)) continue;
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& Node : Run->GetObjectField(TEXT("Nodes"))->Values)
+		{
+			const TSharedPtr<FJsonObject>* BaselineNode = nullptr;
+			if ((*BaselineNodes)->TryGetObjectField(Node.Key, BaselineNode))
+			{
+				Compare(Agents, Node.Key + TEXT(".NsPerCall"), Node.Value->AsObject()->GetNumberField(TEXT("NsPerCall")), (*BaselineNode)->GetNumberField(TEXT("NsPerCall")));
+			}
+		}
+	}
+	return Regressions;
+}
@@ -0,0 +1,125 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeMemory.h"
+
+#include "StateTree.h"
+#include "StateTreeInstanceData.h"
+#include "UHLStateTree.h"
+#include "Components/UHLStateTreeAIComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+LLM_DEFINE_TAG(UHLStateTree);
+LLM_DEFINE_TAG(UHLStateTree_InstanceData, NAME_None, TEXT("UHLStateTree"));
+LLM_DEFINE_TAG(UHLStateTree_Cooldowns, NAME_None, TEXT("UHLStateTree"));
+LLM_DEFINE_TAG(UHLStateTree_Net, NAME_None, TEXT("UHLStateTree"));
+LLM_DEFINE_TAG(UHLStateTree_Navigation, NAME_None, TEXT("UHLStateTree"));
+
+SIZE_T UHLStateTreeMemory::GetAllocatedSize(const UStruct* Struct, const void* Data)
+{
+	if (!Struct || !Data) return 0;
+
+	SIZE_T Size = 0;
+	for (TFieldIterator<FProperty> It(Struct); It; ++It)
+	{
+		for (int32 Index = 0; Index < It->ArrayDim; Index++)
+		{
+			const void* Value = It->ContainerPtrToValuePtr<void>(Data, Index);
+			if (const FStrProperty* StrProperty = CastField<FStrProperty>(*It))
+			{
+				Size += StrProperty->GetPropertyValuePtr(Value)->GetAllocatedSize();
+			}
+			else if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(*It))
+			{
+				FScriptArrayHelper ArrayHelper(ArrayProperty, Value);
+				Size += ArrayHelper.Num() * ArrayProperty->Inner->GetSize();
+			}
+			else if (const FStructProperty* StructProperty = CastField<FStructProperty>(*It))
+			{
+				Size += GetAllocatedSize(StructProperty->Struct, Value);
+			}
+		}
+	}
+	return Size;
+}
+
+namespace UHLStateTreeMemory
+{
+	struct FNodeTypeUsage
+	{
+		int32 Instances = 0;
+		SIZE_T InlineBytes = 0;
+		SIZE_T HeapBytes = 0;
+	};
+
+	struct FAssetUsage
+	{
+		int32 Agents = 0;
+		SIZE_T InstanceDataBytes = 0;
+		TMap<const UStruct*, FNodeTypeUsage> NodeTypes;
+	};
+
+	static bool IsUHLStruct(const UStruct* Struct)
+	{
+		static const FName PackageName(TEXT("/Script/UHLStateTree"));
+		return Struct && Struct->GetOutermost()->GetFName() == PackageName;
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs ReportCommand(
+		TEXT("uhl.StateTree.MemReport"),
+		TEXT("Logs instance data bytes per agent for every StateTree asset and UHL node type of running UHL StateTree agents."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (!World) return;
+
+			TMap<const UStateTree*, FAssetUsage> Assets;
+			int32 NumAgents = 0;
+			SIZE_T CooldownBytes = 0;
+			for (TObjectIterator<UUHLStateTreeAIComponent> It; It; ++It)
+			{
+				const UUHLStateTreeAIComponent* Component = *It;
+				if (Component->GetWorld() != World || !Component->IsRunning()) continue;
+
+				const FStateTreeInstanceData& InstanceData = Component->GetTreeInstanceData();
+				FAssetUsage& Asset = Assets.FindOrAdd(Component->GetStateTreeAsset());
+				Asset.Agents++;
+				Asset.InstanceDataBytes += InstanceData.GetEstimatedMemoryUsage();
+
+				for (int32 Index = 0; Index < InstanceData.Num(); Index++)
+				{
+					const FConstStructView InstanceView = InstanceData.GetStruct(Index);
+					const UScriptStruct* Struct = InstanceView.GetScriptStruct();
+					if (!IsUHLStruct(Struct)) continue;
+
+					FNodeTypeUsage& Usage = Asset.NodeTypes.FindOrAdd(Struct);
+					Usage.Instances++;
+					Usage.InlineBytes += Struct->GetStructureSize();
+					Usage.HeapBytes += GetAllocatedSize(Struct, InstanceView.GetMemory());
+				}
+
+				CooldownBytes += Component->TagCooldowns.CooldownTagsMap.GetAllocatedSize();
+				NumAgents++;
+			}
+
+			if (NumAgents == 0)
+			{
+				UE_LOG(LogUHLStateTree, Display, TEXT("No running UHL StateTree agents to report"));
+				return;
+			}
+			UE_LOG(LogUHLStateTree, Display, TEXT("UHL StateTree memory of %d agents, cooldown maps %llu bytes"), NumAgents, static_cast<uint64>(CooldownBytes));
+			for (const TPair<const UStateTree*, FAssetUsage>& AssetPair : Assets)
+			{
+				const FAssetUsage& Asset = AssetPair.Value;
+				UE_LOG(LogUHLStateTree, Display, TEXT("  %s: %d agents, %llu bytes instance data per agent"),
+					*GetNameSafe(AssetPair.Key), Asset.Agents, static_cast<uint64>(Asset.InstanceDataBytes / Asset.Agents));
+
+				for (const TPair<const UStruct*, FNodeTypeUsage>& NodePair : Asset.NodeTypes)
+				{
+					const FNodeTypeUsage& Usage = NodePair.Value;
+					UE_LOG(LogUHLStateTree, Display, TEXT("    %s: %d per agent, %llu inline and %llu heap bytes per agent"),
+						*NodePair.Key->GetName(), Usage.Instances / Asset.Agents,
+						static_cast<uint64>(Usage.InlineBytes / Asset.Agents), static_cast<uint64>(Usage.HeapBytes / Asset.Agents));
+				}
+			}
+		}));
+}
@@ -0,0 +1,325 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeMicroBench.h"
+
+#if !UE_BUILD_SHIPPING
+#include "AIController.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameplayTagsManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UHLStateTree.h"
+#include "Components/UHLStateTreeAIComponent.h"
+#include "Conditions/UHLSTCondition_InAngle.h"
+#include "Conditions/UHLSTCondition_InRange.h"
+#include "Conditions/UHLSTCondition_TagCooldown.h"
+#include "Core/UHLFocusArbiter.h"
+
+namespace UHLStateTreeMicroBench
+{
+	/** Allocations of the current thread while it's inside FAllocationCountScope */
+	static thread_local bool bCountAllocations = false;
+	static thread_local uint64 ThreadAllocations = 0;
+
+	/**
+	 * Forwards every call to the engine allocator and counts allocations of threads inside FAllocationCountScope.
+	 * GMalloc only while Run measures, but never deleted since other threads may still be inside it.
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInner)
+			: Inner(InInner)
+		{
+		}
+
+		FMalloc* GetInner() const { return Inner; }
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void* MallocZeroed(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->MallocZeroed(Count, Alignment);
+		}
+
+		virtual void* TryMallocZeroed(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->TryMallocZeroed(Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void MarkTLSCachesAsUsedOnCurrentThread() override { Inner->MarkTLSCachesAsUsedOnCurrentThread(); }
+		virtual void MarkTLSCachesAsUnusedOnCurrentThread() override { Inner->MarkTLSCachesAsUnusedOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+		virtual void OnMallocInitialized() override { Inner->OnMallocInitialized(); }
+		virtual void OnPreFork() override { Inner->OnPreFork(); }
+		virtual void OnPostFork() override { Inner->OnPostFork(); }
+		virtual bool Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar) override { return Inner->Exec(InWorld, Cmd, Ar); }
+
+	private:
+		static void CountAllocation()
+		{
+			if (bCountAllocations)
+			{
+				ThreadAllocations++;
+			}
+		}
+
+		FMalloc* Inner;
+	};
+
+	static FCountingMalloc* CountingMalloc = nullptr;
+
+	/** Puts the counting proxy in front of GMalloc until UninstallCountingMalloc */
+	static void InstallCountingMalloc()
+	{
+		if (GMalloc == CountingMalloc) return;
+		if (!CountingMalloc || CountingMalloc->GetInner() != GMalloc)
+		{
+			// the previous proxy, if any, is leaked on purpose, see FCountingMalloc
+			CountingMalloc = new FCountingMalloc(GMalloc);
+		}
+		GMalloc = CountingMalloc;
+	}
+
+	static void UninstallCountingMalloc()
+	{
+		if (CountingMalloc && GMalloc == CountingMalloc)
+		{
+			GMalloc = CountingMalloc->GetInner();
+		}
+	}
+
+	/** Counts allocations of the current thread only */
+	struct FAllocationCountScope
+	{
+		FAllocationCountScope()
+		{
+			ThreadAllocations = 0;
+			bCountAllocations = true;
+		}
+
+		~FAllocationCountScope()
+		{
+			bCountAllocations = false;
+		}
+
+		uint64 GetAllocations() const { return ThreadAllocations; }
+	};
+
+	struct FResult
+	{
+		FString Name;
+		double NsPerCall = 0.0;
+		double AllocationsPerCall = 0.0;
+	};
+
+	/** Keeps results of benchmarked calls observable */
+	static volatile int32 Sink = 0;
+
+	template <typename FuncType>
+	static FResult Measure(const TCHAR* Name, int32 Iterations, FuncType&& Func)
+	{
+		// warm caches and lazily allocated containers
+		for (int32 Index = 0; Index < FMath::Min(Iterations, 1000); Index++)
+		{
+			Func(Index);
+		}
+
+		uint64 Cycles = 0;
+		uint64 Allocations = 0;
+		{
+			FAllocationCountScope AllocationCount;
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (int32 Index = 0; Index < Iterations; Index++)
+			{
+				Func(Index);
+			}
+			Cycles = FPlatformTime::Cycles64() - StartCycles;
+			Allocations = AllocationCount.GetAllocations();
+		}
+
+		FResult Result;
+		Result.Name = Name;
+		Result.NsPerCall = FPlatformTime::ToMilliseconds64(Cycles) * 1e6 / Iterations;
+		Result.AllocationsPerCall = static_cast<double>(Allocations) / Iterations;
+		UE_LOG(LogUHLStateTree, Display, TEXT("%-24s %10.1f ns/call %8.3f allocs/call"), Name, Result.NsPerCall, Result.AllocationsPerCall);
+		return Result;
+	}
+
+	static FAutoConsoleCommand MicroBenchCommand(
+		TEXT("uhl.StateTree.MicroBench"),
+		TEXT("Runs UHL node microbenchmarks. [Iterations=1000000] [Output=<name>] [-Quit]\n")
+		TEXT("Headless smoke run of all node logic, e.g. on a Linux server: -ExecCmds=\"uhl.StateTree.MicroBench Iterations=1000 -Quit\""),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const FString Params = FString::Join(Args, TEXT(" "));
+			int32 Iterations = 1000000;
+			FString OutputName;
+			FParse::Value(*Params, TEXT("Iterations="), Iterations);
+			FParse::Value(*Params, TEXT("Output="), OutputName);
+			Run(FMath::Max(1, Iterations), OutputName, FParse::Param(*Params, TEXT("Quit")));
+		}));
+}
+
+void UHLStateTreeMicroBench::Run(int32 Iterations, const FString& OutputName, bool bQuitWhenDone)
+{
+	if (!GEngine) return;
+	InstallCountingMalloc();
+
+	// world isn't begun play, so components don't start logic or tick on their own
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("UHLStateTreeMicroBench"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ACharacter* Self = World->SpawnActor<ACharacter>(FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+	ACharacter* Other = World->SpawnActor<ACharacter>(FVector(500.0f, 200.0f, 0.0f), FRotator::ZeroRotator, SpawnParams);
+	// brain is a UUHLStateTreeAIComponent without a tree
+	AAIController* Controller = World->SpawnActor<AAIController>(SpawnParams);
+	UUHLStateTreeAIComponent* Component = NewObject<UUHLStateTreeAIComponent>(Controller, TEXT("StateTreeComponent"));
+	Component->RegisterComponent();
+	Controller->BrainComponent = Component;
+	Controller->Possess(Self);
+
+	FGameplayTagContainer AllTags;
+	UGameplayTagsManager::Get().RequestAllGameplayTags(AllTags, true);
+	const FGameplayTag CooldownTag = AllTags.IsEmpty() ? FGameplayTag() : AllTags.First();
+
+	TArray<FResult> Results;
+
+	FUHLSTCondition_InRange::FInstanceDataType InRangeData;
+	InRangeData.Character = Self;
+	InRangeData.OtherCharacter = Other;
+	InRangeData.Range = FFloatRange(0.0f, 1000.0f);
+	Results.Add(Measure(TEXT("InRange"), Iterations, [&InRangeData](int32)
+	{
+		Sink = Sink + FUHLSTCondition_InRange::Evaluate(InRangeData);
+	}));
+
+	FUHLSTCondition_InAngle::FInstanceDataType InAngleData;
+	InAngleData.Character = Self;
+	InAngleData.OtherCharacter = Other;
+	InAngleData.Ranges = { FFloatRange(-45.0f, 45.0f), FFloatRange(135.0f, 180.0f) };
+	Results.Add(Measure(TEXT("InAngle"), Iterations, [&InAngleData](int32)
+	{
+		Sink = Sink + FUHLSTCondition_InAngle::Evaluate(InAngleData);
+	}));
+
+	if (CooldownTag.IsValid())
+	{
+		Results.Add(Measure(TEXT("SetCooldown"), Iterations, [Component, Controller, CooldownTag](int32)
+		{
+			Component->TagCooldowns.AddCooldownTagDuration(Controller, CooldownTag, 1.0f, false);
+		}));
+
+		FUHLSTCondition_TagCooldown::FInstanceDataType TagCooldownData;
+		TagCooldownData.CooldownTag = CooldownTag;
+		Results.Add(Measure(TEXT("TagCooldown"), Iterations, [&TagCooldownData, Controller](int32)
+		{
+			Sink = Sink + FUHLSTCondition_TagCooldown::Evaluate(TagCooldownData, Controller);
+		}));
+	}
+	else
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("No gameplay tags registered, cooldown benchmarks skipped"));
+	}
+
+	// focus writes of GameplayFocus, TurnTo and ClearFocus without the rest of the task bodies:
+	// a request to the arbiter and the resolve after the tree tick, alternating targets so every resolve applies
+	static const uint8 FocusOwner = 0;
+	FUHLFocusArbiter& Arbiter = Component->GetFocusArbiter();
+	Results.Add(Measure(TEXT("FocusActorResolve"), Iterations, [Controller, &Arbiter, Self, Other](int32 Index)
+	{
+		UHLFocus::SetFocus(Controller, &FocusOwner, (Index & 1) ? Self : Other, EAIFocusPriority::Gameplay);
+		Arbiter.Resolve(Controller);
+	}));
+	Results.Add(Measure(TEXT("FocalPointResolve"), Iterations, [Controller, &Arbiter](int32 Index)
+	{
+		UHLFocus::SetFocalPoint(Controller, &FocusOwner, FVector(Index & 1 ? 100.0f : -100.0f, 300.0f, 0.0f), EAIFocusPriority::Gameplay);
+		Arbiter.Resolve(Controller);
+		UHLFocus::ReleaseFocus(Controller, &FocusOwner, EAIFocusPriority::Gameplay);
+	}));
+	Results.Add(Measure(TEXT("FocusClearResolve"), Iterations, [Controller, &Arbiter, Other](int32)
+	{
+		UHLFocus::SetFocus(Controller, &FocusOwner, Other, EAIFocusPriority::Gameplay);
+		Arbiter.ClearRequests(EAIFocusPriority::Gameplay, MAX_int32);
+		Arbiter.Resolve(Controller);
+	}));
+	Arbiter.Reset(Controller);
+	UninstallCountingMalloc();
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetNumberField(TEXT("Iterations"), Iterations);
+	Json->SetStringField(TEXT("Platform"), FPlatformProperties::IniPlatformName());
+	TSharedRef<FJsonObject> Nodes = MakeShared<FJsonObject>();
+	for (const FResult& Result : Results)
+	{
+		TSharedRef<FJsonObject> Node = MakeShared<FJsonObject>();
+		Node->SetNumberField(TEXT("NsPerCall"), Result.NsPerCall);
+		Node->SetNumberField(TEXT("AllocationsPerCall"), Result.AllocationsPerCall);
+		Nodes->SetObjectField(Result.Name, Node);
+	}
+	Json->SetObjectField(TEXT("Nodes"), Nodes);
+
+	FString JsonString;
+	FJsonSerializer::Serialize(Json, TJsonWriterFactory<>::Create(&JsonString));
+	const FString Name = OutputName.IsEmpty() ? FString::Printf(TEXT("MicroBench-%s"), *FDateTime::Now().ToString()) : OutputName;
+	const FString Path = FPaths::ProfilingDir() / TEXT("UHLStateTree") / Name + TEXT(".json");
+	if (FFileHelper::SaveStringToFile(JsonString, *Path))
+	{
+		UE_LOG(LogUHLStateTree, Display, TEXT("StateTree microbenchmark results written to %s"), *Path);
+	}
+
+	if (bQuitWhenDone)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, 0);
+	}
+}
+#endif
@@ -0,0 +1,118 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeParallel.h"
+
+#include "StateTree.h"
+#include "StateTreeReference.h"
+
+namespace UHLStateTreeParallel
+{
+	/** Filled at module startup and by projects before agents start, read-only afterwards */
+	static TSet<const UScriptStruct*> ThreadSafeNodes;
+
+	static thread_local FUHLStateTreeCommandBuffer* CurrentBuffer = nullptr;
+
+	static bool IsTreeThreadSafeRecursive(const UStateTree* StateTree, TSet<const UStateTree*>& Visited)
+	{
+		if (!StateTree) return true;
+		if (!StateTree->IsReadyToRun()) return false;
+
+		bool bAlreadyVisited = false;
+		Visited.Add(StateTree, &bAlreadyVisited);
+		if (bAlreadyVisited) return true;
+
+		const FInstancedStructContainer& Nodes = StateTree->GetNodes();
+		for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+		{
+			if (!IsNodeThreadSafe(Nodes[Index].GetScriptStruct()))
+			{
+				return false;
+			}
+		}
+
+		for (const FCompactStateTreeState& State : StateTree->GetStates())
+		{
+			if (!IsTreeThreadSafeRecursive(State.LinkedAsset, Visited))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void RegisterThreadSafeNode(const UScriptStruct* NodeStruct)
+	{
+		check(IsInGameThread());
+		if (NodeStruct)
+		{
+			ThreadSafeNodes.Add(NodeStruct);
+		}
+	}
+
+	bool IsNodeThreadSafe(const UScriptStruct* NodeStruct)
+	{
+		return NodeStruct && ThreadSafeNodes.Contains(NodeStruct);
+	}
+
+	bool IsTreeThreadSafe(const UStateTree* StateTree, const FStateTreeReferenceOverrides* Overrides)
+	{
+		if (!StateTree) return false;
+
+		TSet<const UStateTree*> Visited;
+		if (!IsTreeThreadSafeRecursive(StateTree, Visited)) return false;
+
+		if (Overrides)
+		{
+			for (const FStateTreeReferenceOverrideItem& Item : Overrides->GetOverrideItems())
+			{
+				if (!IsTreeThreadSafeRecursive(Item.GetStateTreeReference().GetStateTree(), Visited))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool IsInParallelTick()
+	{
+		return CurrentBuffer != nullptr;
+	}
+
+	void RunOnGameThread(TUniqueFunction<void()>&& Command)
+	{
+		if (CurrentBuffer)
+		{
+			CurrentBuffer->Add(MoveTemp(Command));
+		}
+		else
+		{
+			check(IsInGameThread());
+			Command();
+		}
+	}
+
+	FCommandScope::FCommandScope(FUHLStateTreeCommandBuffer& Buffer)
+		: PreviousBuffer(CurrentBuffer)
+	{
+		CurrentBuffer = &Buffer;
+	}
+
+	FCommandScope::~FCommandScope()
+	{
+		CurrentBuffer = PreviousBuffer;
+	}
+}
+
+void FUHLStateTreeCommandBuffer::Execute()
+{
+	check(IsInGameThread());
+
+	// commands may queue more commands through RunOnGameThread, which now runs them right away
+	TArray<TUniqueFunction<void()>> ExecutingCommands = MoveTemp(Commands);
+	Commands.Reset();
+	for (TUniqueFunction<void()>& Command : ExecutingCommands)
+	{
+		Command();
+	}
+}
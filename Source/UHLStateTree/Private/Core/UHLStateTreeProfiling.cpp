@@ -0,0 +1,105 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeProfiling.h"
+
+DEFINE_STAT(STAT_UHLStateTree_InRange);
+DEFINE_STAT(STAT_UHLStateTree_InAngle);
+DEFINE_STAT(STAT_UHLStateTree_TagCooldown);
+DEFINE_STAT(STAT_UHLStateTree_ClearFocus);
+DEFINE_STAT(STAT_UHLStateTree_GameplayFocus);
+DEFINE_STAT(STAT_UHLStateTree_PlayAnimMontage);
+DEFINE_STAT(STAT_UHLStateTree_SetCooldown);
+DEFINE_STAT(STAT_UHLStateTree_TurnTo);
+
+UE_TRACE_CHANNEL_DEFINE(UHLStateTreeChannel);
+
+UE_TRACE_EVENT_BEGIN(UHLStateTree, ConditionResult)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, OwnerId)
+	UE_TRACE_EVENT_FIELD(uint8, Node)
+	UE_TRACE_EVENT_FIELD(bool, Result)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(UHLStateTree, TaskStatus)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, OwnerId)
+	UE_TRACE_EVENT_FIELD(uint8, Node)
+	UE_TRACE_EVENT_FIELD(uint8, Status)
+	UE_TRACE_EVENT_FIELD(bool, EnterState)
+UE_TRACE_EVENT_END()
+
+namespace UHLStateTreeProfiling
+{
+	std::atomic<bool> bCapturing = false;
+
+	static std::atomic<uint64> NodeCalls[static_cast<int32>(ENode::MAX)];
+	static std::atomic<uint64> NodeCycles[static_cast<int32>(ENode::MAX)];
+}
+
+const TCHAR* UHLStateTreeProfiling::GetNodeName(ENode Node)
+{
+	switch (Node)
+	{
+	case ENode::InRange: return TEXT("InRange");
+	case ENode::InAngle: return TEXT("InAngle");
+	case ENode::TagCooldown: return TEXT("TagCooldown");
+	case ENode::ClearFocus: return TEXT("ClearFocus");
+	case ENode::GameplayFocus: return TEXT("GameplayFocus");
+	case ENode::PlayAnimMontage: return TEXT("PlayAnimMontage");
+	case ENode::SetCooldown: return TEXT("SetCooldown");
+	case ENode::TurnTo: return TEXT("TurnTo");
+	default: return TEXT("Unknown");
+	}
+}
+
+void UHLStateTreeProfiling::BeginCapture()
+{
+	bCapturing.store(true, std::memory_order_relaxed);
+}
+
+void UHLStateTreeProfiling::EndCapture()
+{
+	bCapturing.store(false, std::memory_order_relaxed);
+}
+
+void UHLStateTreeProfiling::ResetNodeTimings()
+{
+	for (int32 Index = 0; Index < static_cast<int32>(ENode::MAX); Index++)
+	{
+		NodeCalls[Index].store(0, std::memory_order_relaxed);
+		NodeCycles[Index].store(0, std::memory_order_relaxed);
+	}
+}
+
+UHLStateTreeProfiling::FNodeTiming UHLStateTreeProfiling::GetNodeTiming(ENode Node)
+{
+	FNodeTiming Timing;
+	Timing.Calls = NodeCalls[static_cast<int32>(Node)].load(std::memory_order_relaxed);
+	Timing.Cycles = NodeCycles[static_cast<int32>(Node)].load(std::memory_order_relaxed);
+	return Timing;
+}
+
+void UHLStateTreeProfiling::AddNodeTiming(ENode Node, uint64 Cycles)
+{
+	NodeCalls[static_cast<int32>(Node)].fetch_add(1, std::memory_order_relaxed);
+	NodeCycles[static_cast<int32>(Node)].fetch_add(Cycles, std::memory_order_relaxed);
+}
+
+void UHLStateTreeProfiling::TraceConditionResult(ENode Node, const UObject* Owner, bool bResult)
+{
+	UE_TRACE_LOG(UHLStateTree, ConditionResult, UHLStateTreeChannel)
+		<< ConditionResult.Cycle(FPlatformTime::Cycles64())
+		<< ConditionResult.OwnerId(Owner ? Owner->GetUniqueID() : 0)
+		<< ConditionResult.Node(static_cast<uint8>(Node))
+		<< ConditionResult.Result(bResult);
+}
+
+void UHLStateTreeProfiling::TraceTaskStatus(ENode Node, const UObject* Owner, EStateTreeRunStatus Status, bool bEnterState)
+{
+	UE_TRACE_LOG(UHLStateTree, TaskStatus, UHLStateTreeChannel)
+		<< TaskStatus.Cycle(FPlatformTime::Cycles64())
+		<< TaskStatus.OwnerId(Owner ? Owner->GetUniqueID() : 0)
+		<< TaskStatus.Node(static_cast<uint8>(Node))
+		<< TaskStatus.Status(static_cast<uint8>(Status))
+		<< TaskStatus.EnterState(bEnterState);
+}
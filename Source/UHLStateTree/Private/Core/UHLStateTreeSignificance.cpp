@@ -0,0 +1,95 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeSignificance.h"
+
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "AIController.h"
+#include "Components/UHLStateTreeAIComponent.h"
+#include "GameFramework/Pawn.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLStateTreeSignificance)
+
+float UUHLStateTreeSignificanceEvaluator::EvaluateSignificance_Implementation(const UUHLStateTreeAIComponent* Component, const TArray<FVector>& ViewLocations) const
+{
+	const AAIController* AIController = Component ? Cast<AAIController>(Component->GetOwner()) : nullptr;
+	const APawn* Pawn = AIController ? AIController->GetPawn() : nullptr;
+	if (!Pawn) return 0.0f;
+
+	if (CombatTag.IsValid())
+	{
+		const UAbilitySystemComponent* ASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Pawn);
+		if (ASC && ASC->HasMatchingGameplayTag(CombatTag))
+		{
+			return 1.0f;
+		}
+	}
+
+	const FVector PawnLocation = Pawn->GetActorLocation();
+	double ClosestDistSq = TNumericLimits<double>::Max();
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		ClosestDistSq = FMath::Min(ClosestDistSq, FVector::DistSquared(ViewLocation, PawnLocation));
+	}
+
+	float Significance = 0.0f;
+	if (ViewLocations.Num() > 0)
+	{
+		const float Distance = FMath::Sqrt(ClosestDistSq);
+		Significance = 1.0f - FMath::GetRangePct(NearDistance, FMath::Max(FarDistance, NearDistance + 1.0f), FMath::Clamp(Distance, NearDistance, FarDistance));
+	}
+	if (Pawn->WasRecentlyRendered(0.2f))
+	{
+		Significance += OnScreenBonus;
+	}
+	return FMath::Clamp(Significance, 0.0f, 1.0f);
+}
+
+EUHLStateTreeTickRate UUHLStateTreeSignificanceEvaluator::SelectTickRate(float Significance, EUHLStateTreeTickRate CurrentRate, double& InOutDemotionStartTime, double Now) const
+{
+	auto RateForSignificance = [this](float Value)
+	{
+		if (Value >= EveryFrameSignificance) return EUHLStateTreeTickRate::EveryFrame;
+		if (Value >= MediumRateSignificance) return EUHLStateTreeTickRate::Medium;
+		return EUHLStateTreeTickRate::Low;
+	};
+
+	const EUHLStateTreeTickRate DesiredRate = RateForSignificance(Significance);
+	if (DesiredRate <= CurrentRate)
+	{
+		// promotion or same rate
+		InOutDemotionStartTime = -1.0;
+		return DesiredRate;
+	}
+
+	// demote only when clearly below the current rate's threshold
+	if (RateForSignificance(Significance + HysteresisMargin) <= CurrentRate)
+	{
+		InOutDemotionStartTime = -1.0;
+		return CurrentRate;
+	}
+	if (InOutDemotionStartTime < 0.0)
+	{
+		InOutDemotionStartTime = Now;
+	}
+	if (Now - InOutDemotionStartTime < DemotionDelay)
+	{
+		return CurrentRate;
+	}
+
+	InOutDemotionStartTime = -1.0;
+	return static_cast<EUHLStateTreeTickRate>(static_cast<uint8>(CurrentRate) + 1);
+}
+
+float UUHLStateTreeSignificanceEvaluator::GetTickRateInterval(EUHLStateTreeTickRate Rate) const
+{
+	switch (Rate)
+	{
+	case EUHLStateTreeTickRate::Medium:
+		return MediumRateInterval;
+	case EUHLStateTreeTickRate::Low:
+		return LowRateInterval;
+	default:
+		return 0.0f;
+	}
+}
@@ -0,0 +1,182 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeSnapshot.h"
+
+#include "GameplayTagContainer.h"
+#include "StateTreeInstanceData.h"
+#include "UHLStateTree.h"
+#include "Components/UHLStateTreeAIComponent.h"
+#include "Core/UHLStateTreeMemory.h"
+#include "Core/UHLTagCooldowns.h"
+#include "Tasks/UHLSTTask_ClearFocus.h"
+#include "Tasks/UHLSTTask_GameplayFocus.h"
+#include "Tasks/UHLSTTask_PlayAnimMontage.h"
+#include "Tasks/UHLSTTask_TurnTo.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "UObject/UObjectIterator.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLStateTreeSnapshot)
+
+/** Name of an active UHL task whose runtime state lives outside the instance data, nullptr if there's none */
+static const TCHAR* UHL_FindUnrestorableTask(const FConstStructView Struct)
+{
+	// waits for montage delegates bound in EnterState
+	if (Struct.GetPtr<const FUHLSTTask_PlayAnimMontageInstanceData>()) return TEXT("PlayAnimMontage");
+	// focus requests are keyed by a transient owner and held by the component's arbiter
+	if (Struct.GetPtr<const FUHLSTTask_GameplayFocusInstanceData>()) return TEXT("GameplayFocus");
+	if (Struct.GetPtr<const FUHLSTTask_ClearFocusInstanceData>()) return TEXT("ClearFocus");
+	if (Struct.GetPtr<const FUHLSTTask_TurnToInstanceData>()) return TEXT("TurnTo");
+	return nullptr;
+}
+
+bool UHLStateTreeSnapshot::CanSnapshot(const FStateTreeInstanceData& InstanceData, FString* OutReason)
+{
+	for (int32 Index = 0; Index < InstanceData.Num(); Index++)
+	{
+		// node instance objects of runtime spawned agents have transient paths and don't resolve on restore
+		if (InstanceData.IsObject(Index))
+		{
+			if (OutReason)
+			{
+				*OutReason = FString::Printf(TEXT("instance object %s"), *GetNameSafe(InstanceData.GetObject(Index)));
+			}
+			return false;
+		}
+		if (const TCHAR* TaskName = UHL_FindUnrestorableTask(InstanceData.GetStruct(Index)))
+		{
+			if (OutReason)
+			{
+				*OutReason = FString::Printf(TEXT("active %s task"), TaskName);
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+bool UHLStateTreeSnapshot::Write(FStateTreeInstanceData& InstanceData, const FUHLTagCooldowns& TagCooldowns, double Now, TArray<uint8>& OutData)
+{
+	OutData.Reset();
+
+	FString Reason;
+	if (!CanSnapshot(InstanceData, &Reason))
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("StateTree snapshot rejected: %s can't be restored"), *Reason);
+		return false;
+	}
+
+	FMemoryWriter Writer(OutData);
+	FObjectAndNameAsStringProxyArchive Ar(Writer, false);
+
+	uint8 Version = FUHLStateTreeSnapshot::Version;
+	Ar << Version;
+
+	// execution state with active states lives in the instance data as well
+	FStateTreeInstanceData::StaticStruct()->SerializeItem(Ar, &InstanceData, nullptr);
+
+	// world time doesn't carry over between sessions, expired cooldowns are dropped
+	int32 NumCooldowns = 0;
+	for (const TPair<FGameplayTag, double>& Pair : TagCooldowns.CooldownTagsMap)
+	{
+		NumCooldowns += Pair.Value > Now ? 1 : 0;
+	}
+	Ar << NumCooldowns;
+	for (const TPair<FGameplayTag, double>& Pair : TagCooldowns.CooldownTagsMap)
+	{
+		if (Pair.Value <= Now) continue;
+		FName TagName = Pair.Key.GetTagName();
+		float Remaining = static_cast<float>(Pair.Value - Now);
+		Ar << TagName;
+		Ar << Remaining;
+	}
+	return !Ar.IsError();
+}
+
+bool UHLStateTreeSnapshot::Read(const TArray<uint8>& Data, double Now, FStateTreeInstanceData& OutInstanceData, FUHLTagCooldowns& OutTagCooldowns)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_InstanceData);
+	FMemoryReader Reader(Data);
+	FObjectAndNameAsStringProxyArchive Ar(Reader, true);
+
+	uint8 Version = 0;
+	Ar << Version;
+	if (Version != FUHLStateTreeSnapshot::Version)
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("StateTree snapshot version %d doesn't match %d"), Version, FUHLStateTreeSnapshot::Version);
+		return false;
+	}
+
+	FStateTreeInstanceData::StaticStruct()->SerializeItem(Ar, &OutInstanceData, nullptr);
+
+	FString Reason;
+	if (!Ar.IsError() && !CanSnapshot(OutInstanceData, &Reason))
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("StateTree snapshot rejected: %s can't be restored"), *Reason);
+		return false;
+	}
+
+	int32 NumCooldowns = 0;
+	Ar << NumCooldowns;
+	OutTagCooldowns.CooldownTagsMap.Reset();
+	for (int32 Index = 0; Index < NumCooldowns && !Ar.IsError(); Index++)
+	{
+		FName TagName;
+		float Remaining = 0.0f;
+		Ar << TagName;
+		Ar << Remaining;
+		const FGameplayTag Tag = FGameplayTag::RequestGameplayTag(TagName, false);
+		if (Tag.IsValid())
+		{
+			OutTagCooldowns.CooldownTagsMap.Add(Tag, Now + Remaining);
+		}
+	}
+	return !Ar.IsError();
+}
+
+namespace UHLStateTreeSnapshot
+{
+	// writes and reads back snapshots of all running agents without touching them
+	static FAutoConsoleCommandWithWorldAndArgs MeasureCommand(
+		TEXT("uhl.StateTree.Snapshot.Measure"),
+		TEXT("Logs average snapshot write and read cost per running UHL StateTree agent in microseconds and bytes."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (!World) return;
+
+			const double Now = World->GetTimeSeconds();
+			int32 NumAgents = 0;
+			int64 TotalBytes = 0;
+			double WriteSeconds = 0.0;
+			double ReadSeconds = 0.0;
+			for (TObjectIterator<UUHLStateTreeAIComponent> It; It; ++It)
+			{
+				UUHLStateTreeAIComponent* Component = *It;
+				if (Component->GetWorld() != World || !Component->IsRunning()) continue;
+
+				FUHLStateTreeSnapshot Snapshot;
+				const double WriteStart = FPlatformTime::Seconds();
+				if (!Component->SaveSnapshot(Snapshot)) continue;
+				WriteSeconds += FPlatformTime::Seconds() - WriteStart;
+
+				FStateTreeInstanceData ScratchInstanceData;
+				FUHLTagCooldowns ScratchCooldowns;
+				const double ReadStart = FPlatformTime::Seconds();
+				Read(Snapshot.Data, Now, ScratchInstanceData, ScratchCooldowns);
+				ReadSeconds += FPlatformTime::Seconds() - ReadStart;
+
+				TotalBytes += Snapshot.Data.Num();
+				NumAgents++;
+			}
+
+			if (NumAgents == 0)
+			{
+				UE_LOG(LogUHLStateTree, Display, TEXT("No running UHL StateTree agents to snapshot"));
+				return;
+			}
+			UE_LOG(LogUHLStateTree, Display, TEXT("StateTree snapshot of %d agents: write %.2f us, read %.2f us, %lld bytes per agent"),
+				NumAgents, WriteSeconds * 1e6 / NumAgents, ReadSeconds * 1e6 / NumAgents, TotalBytes / NumAgents);
+		}));
+}
@@ -0,0 +1,102 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Core/UHLStateTreeTelemetry.h"
+
+#include "ProfilingDebugging/CsvProfiler.h"
+#include <atomic>
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLStateTreeTelemetry)
+
+CSV_DEFINE_CATEGORY(UHLStateTree, true);
+
+namespace UHLStateTreeTelemetry
+{
+	static std::atomic<int32> ActiveAgents = 0;
+	static std::atomic<int32> SleepingAgents = 0;
+
+	// per frame
+	static std::atomic<int32> TickedAgents = 0;
+	static std::atomic<int32> ConditionEvaluations = 0;
+	static std::atomic<int32> MontageRPCs = 0;
+	static std::atomic<int64> CooldownEntries = 0;
+	static std::atomic<int32> MaxCooldownEntries = 0;
+	static std::atomic<uint64> TickCycles = 0;
+	static std::atomic<uint64> MaxTickCycles = 0;
+
+	/** Written on the game thread only */
+	static FUHLStateTreeTelemetry LastFrame;
+
+	template <typename T>
+	static void AtomicMax(std::atomic<T>& Target, T Value)
+	{
+		T Current = Target.load(std::memory_order_relaxed);
+		while (Value > Current && !Target.compare_exchange_weak(Current, Value, std::memory_order_relaxed))
+		{
+		}
+	}
+}
+
+FUHLStateTreeTelemetry UHLStateTreeTelemetry::GetLastFrame()
+{
+	check(IsInGameThread());
+	return LastFrame;
+}
+
+void UHLStateTreeTelemetry::AddActiveAgent(int32 Delta)
+{
+	ActiveAgents.fetch_add(Delta, std::memory_order_relaxed);
+}
+
+void UHLStateTreeTelemetry::AddSleepingAgent(int32 Delta)
+{
+	SleepingAgents.fetch_add(Delta, std::memory_order_relaxed);
+}
+
+void UHLStateTreeTelemetry::AddConditionEvaluation()
+{
+	ConditionEvaluations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void UHLStateTreeTelemetry::AddMontageRPC()
+{
+	MontageRPCs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void UHLStateTreeTelemetry::AddAgentTick(uint64 Cycles, int32 InCooldownEntries)
+{
+	TickedAgents.fetch_add(1, std::memory_order_relaxed);
+	TickCycles.fetch_add(Cycles, std::memory_order_relaxed);
+	AtomicMax(MaxTickCycles, Cycles);
+	CooldownEntries.fetch_add(InCooldownEntries, std::memory_order_relaxed);
+	AtomicMax(MaxCooldownEntries, InCooldownEntries);
+}
+
+void UHLStateTreeTelemetry::EndFrame()
+{
+	FUHLStateTreeTelemetry Frame;
+	Frame.ActiveAgents = ActiveAgents.load(std::memory_order_relaxed);
+	Frame.SleepingAgents = SleepingAgents.load(std::memory_order_relaxed);
+	Frame.TickedAgents = TickedAgents.exchange(0, std::memory_order_relaxed);
+	Frame.ConditionEvaluations = ConditionEvaluations.exchange(0, std::memory_order_relaxed);
+	Frame.MontageRPCs = MontageRPCs.exchange(0, std::memory_order_relaxed);
+	Frame.MaxCooldownEntries = MaxCooldownEntries.exchange(0, std::memory_order_relaxed);
+	const int64 SumCooldownEntries = CooldownEntries.exchange(0, std::memory_order_relaxed);
+	const uint64 SumTickCycles = TickCycles.exchange(0, std::memory_order_relaxed);
+	Frame.MaxAgentTickMs = static_cast<float>(FPlatformTime::ToMilliseconds64(MaxTickCycles.exchange(0, std::memory_order_relaxed)));
+	if (Frame.TickedAgents > 0)
+	{
+		Frame.AvgCooldownEntries = static_cast<float>(SumCooldownEntries) / Frame.TickedAgents;
+		Frame.AvgAgentTickMs = static_cast<float>(FPlatformTime::ToMilliseconds64(SumTickCycles) / Frame.TickedAgents);
+	}
+	LastFrame = Frame;
+
+	CSV_CUSTOM_STAT(UHLStateTree, ActiveAgents, Frame.ActiveAgents, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(UHLStateTree, SleepingAgents, Frame.SleepingAgents, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(UHLStateTree, TickedAgents, Frame.TickedAgents, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(UHLStateTree, ConditionEvaluations, Frame.ConditionEvaluations, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(UHLStateTree, MontageRPCs, Frame.MontageRPCs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(UHLStateTree, AvgCooldownEntries, Frame.AvgCooldownEntries, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(UHLStateTree, MaxCooldownEntries, Frame.MaxCooldownEntries, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(UHLStateTree, AvgAgentTickMs, Frame.AvgAgentTickMs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(UHLStateTree, MaxAgentTickMs, Frame.MaxAgentTickMs, ECsvCustomStatOp::Set);
+}
@@ -2,8 +2,11 @@
 
 #include "Core/UHLTagCooldowns.h"
 
+#include "Core/UHLStateTreeMemory.h"
+
 void FUHLTagCooldowns::AddCooldownTagDuration(const UObject* Context, const FGameplayTag& CooldownTag, float Duration, bool bAddToExistingDuration)
 {
+	LLM_SCOPE_BYTAG(UHLStateTree_Cooldowns);
 	if (!Context) return;
 	if (!CooldownTag.IsValid()) return;
 	if (!ensure(Duration > 0.f)) return;
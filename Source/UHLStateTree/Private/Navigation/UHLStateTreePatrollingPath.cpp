@@ -4,6 +4,7 @@
 #include "Navigation/UHLStateTreePatrollingPath.h"
 
 #include "Components/SplineComponent.h"
+#include "Core/UHLStateTreeMemory.h"
 
 AUHLStateTreePatrollingPath::AUHLStateTreePatrollingPath()
 {
@@ -18,11 +19,12 @@ AUHLStateTreePatrollingPath::AUHLStateTreePatrollingPath()
 
 const TArray<FVector>& AUHLStateTreePatrollingPath::GetWaypoints() const
 {
-    Waypoints->Empty();
+    LLM_SCOPE_BYTAG(UHLStateTree_Navigation);
+    Waypoints.Reset(Spline->GetNumberOfSplinePoints());
 
     for (int32 i = 0; i < Spline->GetNumberOfSplinePoints(); i++)
     {
-        Waypoints->Add(Spline->GetLocationAtSplinePoint(i, ESplineCoordinateSpace::Local));
+        Waypoints.Add(Spline->GetLocationAtSplinePoint(i, ESplineCoordinateSpace::Local));
     }
-    return *Waypoints;
+    return Waypoints;
 }
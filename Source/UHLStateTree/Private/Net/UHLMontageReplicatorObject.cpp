@@ -1,12 +1,124 @@
 // Pavel Penkov 2025 All Rights Reserved.
 
 #include "Net/UHLMontageReplicatorObject.h"
+#include "UHLStateTree.h"
 #include "Animation/AnimInstance.h"
 #include "Engine/ActorChannel.h"
+#include "Engine/World.h"
+#include "Core/UHLStateTreeMemory.h"
+#include "Core/UHLStateTreeParallel.h"
+#include "Core/UHLStateTreeTelemetry.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
+#include "UObject/UObjectHash.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLMontageReplicatorObject)
+
+bool FUHLMontagePlayPacket::SetPlayRate(float PlayRate)
+{
+	const int32 Quantized = FMath::RoundToInt32(PlayRate * PlayRateScale);
+	if (Quantized < 0 || Quantized > MAX_uint16) return false;
+	QuantizedPlayRate = static_cast<uint16>(Quantized);
+	return true;
+}
+
+bool FUHLMontagePlayPacket::SetStartPosition(float StartPosition)
+{
+	const int32 Quantized = FMath::RoundToInt32(StartPosition * PositionScale);
+	if (Quantized < 0 || Quantized > MAX_uint16) return false;
+	QuantizedStartPosition = static_cast<uint16>(Quantized);
+	return true;
+}
+
+void FUHLMontageOp::SetBlendOutTime(float BlendOutTime)
+{
+	QuantizedBlendOutTime = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32(BlendOutTime * FUHLMontagePlayPacket::PositionScale), 0, MAX_uint16));
+}
+
+UUHLMontageReplicatorObject* UUHLMontageReplicatorObject::Find(const AActor* InOwner)
+{
+	if (!InOwner) return nullptr;
+
+	UUHLMontageReplicatorObject* Result = nullptr;
+	ForEachObjectWithOuterBreakable(InOwner, [&Result](UObject* Object)
+	{
+		Result = Cast<UUHLMontageReplicatorObject>(Object);
+		return Result == nullptr;
+	}, false, RF_ClassDefaultObject, EInternalObjectFlags::Garbage);
+	return Result;
+}
+
+UUHLMontageReplicatorObject* UUHLMontageReplicatorObject::GetOrCreate(AActor* InOwner)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_Net);
+	checkSlow(!UHLStateTreeParallel::IsInParallelTick());
+	if (!InOwner || !InOwner->HasAuthority()) return nullptr;
+
+	if (UUHLMontageReplicatorObject* Existing = Find(InOwner))
+	{
+		return Existing;
+	}
+
+	if (!InOwner->IsUsingRegisteredSubObjectList())
+	{
+		UE_LOG(LogUHLStateTree, Warning, TEXT("[UHLMontageReplicator] %s doesn't use the registered subobject list, custom mesh montages won't replicate. Set bReplicateUsingRegisteredSubObjectList"), *GetNameSafe(InOwner));
+	}
+
+	UUHLMontageReplicatorObject* Replicator = NewObject<UUHLMontageReplicatorObject>(InOwner);
+	Replicator->Initialize(InOwner);
+	InOwner->AddReplicatedSubObject(Replicator);
+	return Replicator;
+}
+
+void UUHLMontageReplicatorObject::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	// clients only get here through subobject replication, Initialize runs on the server only
+	if (!HasAnyFlags(RF_ClassDefaultObject))
+	{
+		Owner = GetTypedOuter<AActor>();
+	}
+}
 
 void UUHLMontageReplicatorObject::Initialize(AActor* InOwner)
 {
 	Owner = InOwner;
+	if (Owner)
+	{
+		Owner->OnEndPlay.AddUniqueDynamic(this, &UUHLMontageReplicatorObject::OnOwnerEndPlay);
+	}
+}
+
+void UUHLMontageReplicatorObject::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(FlushHandle);
+	FlushHandle.Reset();
+
+	if (Owner)
+	{
+		Owner->OnEndPlay.RemoveDynamic(this, &UUHLMontageReplicatorObject::OnOwnerEndPlay);
+		if (Owner->IsReplicatedSubObjectRegistered(this))
+		{
+			Owner->RemoveReplicatedSubObject(this);
+		}
+	}
+	Owner = nullptr;
+	MarkAsGarbage();
+}
+
+void UUHLMontageReplicatorObject::OnOwnerEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	Deinitialize();
+}
+
+void UUHLMontageReplicatorObject::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UUHLMontageReplicatorObject, MontageTable);
+	DOREPLIFETIME(UUHLMontageReplicatorObject, MeshSlots);
+	DOREPLIFETIME(UUHLMontageReplicatorObject, MeshMontageStates);
 }
 
 int32 UUHLMontageReplicatorObject::GetFunctionCallspace(UFunction* Function, FFrame* Stack)
@@ -18,6 +130,7 @@ bool UUHLMontageReplicatorObject::CallRemoteFunction(UFunction* Function, void*
 {
 	if (Owner)
 	{
+		// NetDriver routes subobject RPCs through the Iris replication system when it's enabled, legacy channels otherwise
 		UNetDriver* NetDriver = Owner->GetNetDriver();
 		if (NetDriver)
 		{
@@ -28,12 +141,409 @@ bool UUHLMontageReplicatorObject::CallRemoteFunction(UFunction* Function, void*
 	return false;
 }
 
+void UUHLMontageReplicatorObject::RegisterMontages(TConstArrayView<UAnimMontage*> Montages)
+{
+	for (UAnimMontage* Montage : Montages)
+	{
+		FindOrAddMontageIndex(Montage);
+	}
+}
+
+int32 UUHLMontageReplicatorObject::FindOrAddMontageIndex(UAnimMontage* Montage)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_Net);
+	if (!Montage) return INDEX_NONE;
+
+	int32 Index = MontageTable.Find(Montage);
+	if (Index == INDEX_NONE && MontageTable.Num() < FUHLMontagePlayPacket::InvalidIndex)
+	{
+		Index = MontageTable.Add(Montage);
+	}
+	return Index;
+}
+
+int32 UUHLMontageReplicatorObject::FindOrAddMeshSlot(USkeletalMeshComponent* Mesh)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_Net);
+	if (!Mesh) return INDEX_NONE;
+
+	int32 Index = MeshSlots.Find(Mesh);
+	if (Index == INDEX_NONE && MeshSlots.Num() < FUHLMontagePlayPacket::InvalidIndex)
+	{
+		Index = MeshSlots.Add(Mesh);
+	}
+	return Index;
+}
+
+bool UUHLMontageReplicatorObject::PlayMontage(
+	USkeletalMeshComponent* Mesh,
+	UAnimMontage* Montage,
+	float PlayRate,
+	float StartPosition,
+	FName StartSection,
+	EUHLMontageNetDelivery Delivery,
+	TOptional<float> StopAllBlendOutTime,
+	bool bPlayOnServer)
+{
+	checkSlow(!UHLStateTreeParallel::IsInParallelTick());
+	if (!Mesh || !Montage) return false;
+
+	FUHLMontageOp Op;
+	const int32 MeshSlot = FindOrAddMeshSlot(Mesh);
+	const int32 MontageIndex = FindOrAddMontageIndex(Montage);
+	const int32 SectionIndex = StartSection != NAME_None ? Montage->GetSectionIndex(StartSection) : INDEX_NONE;
+
+	const bool bCanUseOp = MeshSlot != INDEX_NONE
+		&& MontageIndex != INDEX_NONE
+		&& SectionIndex < FUHLMontagePlayPacket::InvalidIndex
+		&& (StartSection == NAME_None || SectionIndex != INDEX_NONE)
+		&& Op.Play.SetPlayRate(PlayRate)
+		&& Op.Play.SetStartPosition(StartSection != NAME_None ? 0.0f : StartPosition);
+
+	if (!bCanUseOp && bPlayOnServer)
+	{
+		// batched operations requested earlier must reach clients first
+		SendPendingOps();
+		if (StopAllBlendOutTime.IsSet())
+		{
+			Multicast_StopAllMontages(Mesh, StopAllBlendOutTime.GetValue());
+			UHLStateTreeTelemetry::AddMontageRPC();
+		}
+		Multicast_PlayMontage(Mesh, Montage, PlayRate, StartPosition, StartSection);
+		UHLStateTreeTelemetry::AddMontageRPC();
+		return true;
+	}
+
+	// the fallback multicast has no server-only mode, the caller plays it on the server instead
+	if (!bCanUseOp) return false;
+
+	Op.Play.MeshSlot = static_cast<uint8>(MeshSlot);
+	Op.Play.MontageIndex = static_cast<uint8>(MontageIndex);
+	Op.Play.SectionIndex = SectionIndex != INDEX_NONE ? static_cast<uint8>(SectionIndex) : FUHLMontagePlayPacket::InvalidIndex;
+	if (StopAllBlendOutTime.IsSet())
+	{
+		Op.bStopAllMontages = true;
+		Op.SetBlendOutTime(StopAllBlendOutTime.GetValue());
+		UAnimInstance* AnimInstance = Mesh->GetAnimInstance();
+		if (AnimInstance && bPlayOnServer)
+		{
+			AnimInstance->StopAllMontages(StopAllBlendOutTime.GetValue());
+		}
+	}
+
+	// applied on the server right away, callers bind montage delegates right after this call
+	if (bPlayOnServer)
+	{
+		PlayMontageLocal(Mesh, Montage, PlayRate, StartPosition, StartSection);
+	}
+	SendOp(Op, Delivery);
+	return true;
+}
+
+void UUHLMontageReplicatorObject::StopAllMontages(USkeletalMeshComponent* Mesh, float BlendOutTime, EUHLMontageNetDelivery Delivery)
+{
+	checkSlow(!UHLStateTreeParallel::IsInParallelTick());
+	if (!Mesh) return;
+
+	const int32 MeshSlot = FindOrAddMeshSlot(Mesh);
+	if (MeshSlot == INDEX_NONE)
+	{
+		SendPendingOps();
+		Multicast_StopAllMontages(Mesh, BlendOutTime);
+		UHLStateTreeTelemetry::AddMontageRPC();
+		return;
+	}
+
+	if (UAnimInstance* AnimInstance = Mesh->GetAnimInstance())
+	{
+		AnimInstance->StopAllMontages(BlendOutTime);
+	}
+
+	FUHLMontageOp Op;
+	Op.Play.MeshSlot = static_cast<uint8>(MeshSlot);
+	Op.bStopAllMontages = true;
+	Op.SetBlendOutTime(BlendOutTime);
+	SendOp(Op, Delivery);
+}
+
+void UUHLMontageReplicatorObject::SendOp(const FUHLMontageOp& Op, EUHLMontageNetDelivery Delivery)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_Net);
+	FUHLRepMeshMontageInfo& State = GetMutableMeshMontageState(Op.Play.MeshSlot);
+	if (Delivery == EUHLMontageNetDelivery::ReplicatedState)
+	{
+		State.Op = Op;
+		State.ServerStartTime = GetServerWorldTimeSeconds();
+		MarkMeshMontageStateDirty(State);
+		return;
+	}
+
+	// state of this slot is outdated now, don't let late joiners replay it
+	if (State.IsPlaying())
+	{
+		State.Op = FUHLMontageOp();
+		State.Op.Play.MeshSlot = Op.Play.MeshSlot;
+		MarkMeshMontageStateDirty(State);
+	}
+
+	// reliable and unreliable batches are separate RPCs, switching delivery sends what's batched so far to keep the order
+	const bool bUnreliable = Delivery == EUHLMontageNetDelivery::Unreliable;
+	if ((bUnreliable ? PendingReliableOps : PendingUnreliableOps).Num() > 0)
+	{
+		SendPendingOps();
+	}
+	TArray<FUHLMontageOp>& PendingOps = bUnreliable ? PendingUnreliableOps : PendingReliableOps;
+
+	// only the last play per mesh matters within a frame, but a stop requested earlier must survive
+	FUHLMontageOp* Existing = PendingOps.FindByPredicate([&Op](const FUHLMontageOp& Pending)
+	{
+		return Pending.Play.MeshSlot == Op.Play.MeshSlot;
+	});
+	if (Existing)
+	{
+		const bool bStopAllMontages = Existing->bStopAllMontages || Op.bStopAllMontages;
+		const uint16 QuantizedBlendOutTime = Op.bStopAllMontages ? Op.QuantizedBlendOutTime : Existing->QuantizedBlendOutTime;
+		*Existing = Op;
+		Existing->bStopAllMontages = bStopAllMontages;
+		Existing->QuantizedBlendOutTime = QuantizedBlendOutTime;
+	}
+	else
+	{
+		PendingOps.Add(Op);
+	}
+
+	if (!FlushHandle.IsValid())
+	{
+		FlushHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UUHLMontageReplicatorObject::FlushPendingOps);
+	}
+}
+
+void UUHLMontageReplicatorObject::FlushPendingOps(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld()) return;
+
+	FWorldDelegates::OnWorldPostActorTick.Remove(FlushHandle);
+	FlushHandle.Reset();
+	SendPendingOps();
+}
+
+void UUHLMontageReplicatorObject::SendPendingOps()
+{
+	// only one of the lists has operations, see SendOp
+	if (PendingReliableOps.Num() > 0)
+	{
+		Multicast_MontageOps(PendingReliableOps);
+		UHLStateTreeTelemetry::AddMontageRPC();
+		PendingReliableOps.Reset();
+	}
+	if (PendingUnreliableOps.Num() > 0)
+	{
+		Multicast_MontageOpsUnreliable(PendingUnreliableOps);
+		UHLStateTreeTelemetry::AddMontageRPC();
+		PendingUnreliableOps.Reset();
+	}
+}
+
+FUHLRepMeshMontageInfo& UUHLMontageReplicatorObject::GetMutableMeshMontageState(int32 MeshSlot)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_Net);
+	if (MeshMontageStates.Num() <= MeshSlot)
+	{
+		MeshMontageStates.SetNum(MeshSlot + 1);
+	}
+	return MeshMontageStates[MeshSlot];
+}
+
+void UUHLMontageReplicatorObject::MarkMeshMontageStateDirty(FUHLRepMeshMontageInfo& State)
+{
+	State.ChangeCounter++;
+	if (Owner)
+	{
+		// dormant owners won't replicate the new state otherwise
+		Owner->FlushNetDormancy();
+	}
+}
+
+double UUHLMontageReplicatorObject::GetServerWorldTimeSeconds() const
+{
+	const UWorld* World = GetWorld();
+	if (!World) return 0.0;
+
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+void UUHLMontageReplicatorObject::OnRep_MeshMontageStates()
+{
+	ApplyMeshMontageStates();
+}
+
+void UUHLMontageReplicatorObject::ApplyMeshMontageStates()
+{
+	// slots are never removed, new ones start as "never applied"
+	const int32 PrevNum = AppliedStateCounters.Num();
+	if (PrevNum < MeshMontageStates.Num())
+	{
+		AppliedStateCounters.SetNumUninitialized(MeshMontageStates.Num());
+		for (int32 Slot = PrevNum; Slot < AppliedStateCounters.Num(); Slot++)
+		{
+			AppliedStateCounters[Slot] = INDEX_NONE;
+		}
+	}
+
+	for (int32 Slot = 0; Slot < MeshMontageStates.Num(); Slot++)
+	{
+		const FUHLRepMeshMontageInfo& State = MeshMontageStates[Slot];
+		if (AppliedStateCounters[Slot] == State.ChangeCounter) continue;
+
+		const bool bFirstSeen = AppliedStateCounters[Slot] == INDEX_NONE;
+		if (!MeshSlots.IsValidIndex(Slot) || (State.IsPlaying() && !MontageTable.IsValidIndex(State.Op.Play.MontageIndex)))
+		{
+			// tables not replicated yet, retried from OnRep_Tables
+			continue;
+		}
+		AppliedStateCounters[Slot] = State.ChangeCounter;
+
+		USkeletalMeshComponent* Mesh = MeshSlots[Slot];
+		UAnimInstance* AnimInstance = Mesh ? Mesh->GetAnimInstance() : nullptr;
+		if (!AnimInstance) continue;
+
+		// nothing to stop on a client that never saw this slot playing
+		if (State.Op.bStopAllMontages && !bFirstSeen)
+		{
+			AnimInstance->StopAllMontages(State.Op.GetBlendOutTime());
+		}
+		if (!State.IsPlaying()) continue;
+
+		UAnimMontage* Montage = MontageTable[State.Op.Play.MontageIndex];
+		if (!Montage) continue;
+
+		const FName StartSection = State.Op.Play.SectionIndex != FUHLMontagePlayPacket::InvalidIndex
+			? Montage->GetSectionName(State.Op.Play.SectionIndex)
+			: NAME_None;
+		const float PlayRate = State.Op.Play.GetPlayRate();
+		const double ServerNow = GetServerWorldTimeSeconds();
+		// late joiners resume from the elapsed position, that needs the replicated server clock
+		ensureMsgf(!bFirstSeen || ServerNow > 0.0, TEXT("[UHLMontageReplicator] %s has no server time, late joined montages restart from the beginning"), *GetNameSafe(Owner));
+		// server time is kept double, a float clock loses precision in long sessions
+		const float Elapsed = static_cast<float>(FMath::Max(0.0, ServerNow - State.ServerStartTime)) * PlayRate;
+
+		float Position = State.Op.Play.GetStartPosition();
+		if (StartSection != NAME_None)
+		{
+			Position = Montage->GetAnimCompositeSection(State.Op.Play.SectionIndex).GetTime();
+		}
+		Position += Elapsed;
+
+		// already finished on the server, only late joiners can get here
+		if (bFirstSeen && !Montage->bLoop && Position >= Montage->GetPlayLength())
+		{
+			continue;
+		}
+
+		PlayMontageLocal(Mesh, Montage, PlayRate, State.Op.Play.GetStartPosition(), StartSection);
+		if (bFirstSeen && Elapsed > 0.0f)
+		{
+			AnimInstance->Montage_SetPosition(Montage, Position);
+		}
+	}
+}
+
+void UUHLMontageReplicatorObject::Multicast_MontageOps_Implementation(const TArray<FUHLMontageOp>& Ops)
+{
+	ReceiveOps(Ops, true);
+}
+
+void UUHLMontageReplicatorObject::Multicast_MontageOpsUnreliable_Implementation(const TArray<FUHLMontageOp>& Ops)
+{
+	// cosmetic, late operations are dropped instead of queued
+	ReceiveOps(Ops, false);
+}
+
+void UUHLMontageReplicatorObject::ReceiveOps(const TArray<FUHLMontageOp>& Ops, bool bQueueUnresolved)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_Net);
+	// the server applied the operations when they were requested
+	if (Owner && Owner->HasAuthority()) return;
+
+	for (const FUHLMontageOp& Op : Ops)
+	{
+		if (!ApplyOp(Op) && bQueueUnresolved)
+		{
+			UnresolvedOps.Add(Op);
+		}
+	}
+}
+
+bool UUHLMontageReplicatorObject::ApplyOp(const FUHLMontageOp& Op)
+{
+	if (!MeshSlots.IsValidIndex(Op.Play.MeshSlot) || (Op.HasPlay() && !MontageTable.IsValidIndex(Op.Play.MontageIndex)))
+	{
+		return false;
+	}
+
+	USkeletalMeshComponent* Mesh = MeshSlots[Op.Play.MeshSlot];
+	if (!Mesh)
+	{
+		return false;
+	}
+
+	if (Op.bStopAllMontages)
+	{
+		if (UAnimInstance* AnimInstance = Mesh->GetAnimInstance())
+		{
+			AnimInstance->StopAllMontages(Op.GetBlendOutTime());
+		}
+	}
+
+	if (Op.HasPlay())
+	{
+		UAnimMontage* Montage = MontageTable[Op.Play.MontageIndex];
+		if (!Montage)
+		{
+			return false;
+		}
+
+		const FName StartSection = Op.Play.SectionIndex != FUHLMontagePlayPacket::InvalidIndex
+			? Montage->GetSectionName(Op.Play.SectionIndex)
+			: NAME_None;
+		PlayMontageLocal(Mesh, Montage, Op.Play.GetPlayRate(), Op.Play.GetStartPosition(), StartSection);
+	}
+	return true;
+}
+
+void UUHLMontageReplicatorObject::OnRep_Tables()
+{
+	ApplyMeshMontageStates();
+
+	if (UnresolvedOps.IsEmpty()) return;
+
+	TArray<FUHLMontageOp> Ops = MoveTemp(UnresolvedOps);
+	for (const FUHLMontageOp& Op : Ops)
+	{
+		if (!ApplyOp(Op))
+		{
+			UnresolvedOps.Add(Op);
+		}
+	}
+}
+
 void UUHLMontageReplicatorObject::Multicast_PlayMontage_Implementation(
 	USkeletalMeshComponent* Mesh,
 	UAnimMontage* Montage,
 	float PlayRate,
 	float StartPosition,
 	FName StartSection)
+{
+	PlayMontageLocal(Mesh, Montage, PlayRate, StartPosition, StartSection);
+}
+
+void UUHLMontageReplicatorObject::PlayMontageLocal(
+	USkeletalMeshComponent* Mesh,
+	UAnimMontage* Montage,
+	float PlayRate,
+	float StartPosition,
+	FName StartSection)
 {
 	if (!Mesh || !Montage) return;
 	if (UAnimInstance* AnimInstance = Mesh->GetAnimInstance())
@@ -54,5 +564,3 @@ void UUHLMontageReplicatorObject::Multicast_StopAllMontages_Implementation(USkel
 		AnimInstance->StopAllMontages(BlendOutTime);
 	}
 }
-
-
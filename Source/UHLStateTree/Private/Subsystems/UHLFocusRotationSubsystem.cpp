@@ -0,0 +1,251 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Subsystems/UHLFocusRotationSubsystem.h"
+
+#include "AIController.h"
+#include "UHLStateTree.h"
+#include "AISystem.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "Core/UHLStateTreeAIController.h"
+#include "Core/UHLStateTreeMemory.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLFocusRotationSubsystem)
+
+namespace UHLFocusRotation
+{
+	static int32 ParallelBatchSize = 256;
+	static FAutoConsoleVariableRef CVarParallelBatchSize(
+		TEXT("uhl.StateTree.FocusRotation.ParallelBatchSize"),
+		ParallelBatchSize,
+		TEXT("Number of agents from which focus rotations are computed in parallel, 0 disables parallel compute."));
+
+	enum EAgentFlags : uint8
+	{
+		HasFocalPoint = 1 << 0,
+		AllowPitch = 1 << 1,
+		FromPawnOrientation = 1 << 2,
+	};
+}
+
+void FUHLFocusRotationTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Subsystem->UpdateRotations(DeltaTime);
+	}
+}
+
+FString FUHLFocusRotationTickFunction::DiagnosticMessage()
+{
+	return TEXT("UUHLFocusRotationSubsystem::UpdateRotations");
+}
+
+FName FUHLFocusRotationTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("UHLFocusRotation"));
+}
+
+UUHLFocusRotationSubsystem* UUHLFocusRotationSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<UUHLFocusRotationSubsystem>() : nullptr;
+}
+
+bool UUHLFocusRotationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UUHLFocusRotationSubsystem::AddPawnPrerequisites(APawn* Pawn)
+{
+	if (!Pawn) return;
+
+	Pawn->PrimaryActorTick.AddPrerequisite(this, TickFunction);
+	if (UPawnMovementComponent* Movement = Pawn->GetMovementComponent())
+	{
+		Movement->PrimaryComponentTick.AddPrerequisite(this, TickFunction);
+	}
+}
+
+void UUHLFocusRotationSubsystem::RemovePawnPrerequisites(APawn* Pawn)
+{
+	if (!Pawn) return;
+
+	Pawn->PrimaryActorTick.RemovePrerequisite(this, TickFunction);
+	if (UPawnMovementComponent* Movement = Pawn->GetMovementComponent())
+	{
+		Movement->PrimaryComponentTick.RemovePrerequisite(this, TickFunction);
+	}
+}
+
+bool UUHLFocusRotationSubsystem::RegisterController(AAIController* Controller, float InterpSpeed)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree);
+	AUHLStateTreeAIController* UHLController = Cast<AUHLStateTreeAIController>(Controller);
+	if (!UHLController)
+	{
+		UE_CLOG(Controller != nullptr, LogUHLStateTree, Warning, TEXT("[UHLFocusRotation] %s isn't an AUHLStateTreeAIController, control rotation isn't batched"), *GetNameSafe(Controller));
+		return false;
+	}
+
+	if (!TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.Subsystem = this;
+		TickFunction.TickGroup = TG_PrePhysics;
+		TickFunction.bCanEverTick = true;
+		TickFunction.bStartWithTickEnabled = true;
+		TickFunction.RegisterTickFunction(GetWorld()->PersistentLevel);
+	}
+
+	FAgent* Agent = Agents.FindByPredicate([UHLController](const FAgent& Item) { return Item.Controller == UHLController; });
+	if (!Agent)
+	{
+		Agent = &Agents.AddDefaulted_GetRef();
+		Agent->Controller = UHLController;
+		UHLController->SetBatchedFocusRotation(true);
+	}
+	if (Agent->Pawn != UHLController->GetPawn())
+	{
+		RemovePawnPrerequisites(Agent->Pawn.Get());
+		Agent->Pawn = UHLController->GetPawn();
+		AddPawnPrerequisites(Agent->Pawn.Get());
+	}
+	Agent->InterpSpeed = InterpSpeed;
+	return true;
+}
+
+void UUHLFocusRotationSubsystem::UnregisterController(AAIController* Controller)
+{
+	const int32 Index = Agents.IndexOfByPredicate([Controller](const FAgent& Item) { return Item.Controller == Controller; });
+	if (Index == INDEX_NONE) return;
+
+	if (AUHLStateTreeAIController* UHLController = Agents[Index].Controller.Get())
+	{
+		UHLController->SetBatchedFocusRotation(false);
+	}
+	RemovePawnPrerequisites(Agents[Index].Pawn.Get());
+	Agents.RemoveAtSwap(Index);
+}
+
+void UUHLFocusRotationSubsystem::Deinitialize()
+{
+	for (const FAgent& Agent : Agents)
+	{
+		if (AUHLStateTreeAIController* Controller = Agent.Controller.Get())
+		{
+			Controller->SetBatchedFocusRotation(false);
+		}
+		RemovePawnPrerequisites(Agent.Pawn.Get());
+	}
+	Agents.Reset();
+
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+
+	Super::Deinitialize();
+}
+
+void UUHLFocusRotationSubsystem::UpdateRotations(float DeltaTime)
+{
+	using namespace UHLFocusRotation;
+
+	Agents.RemoveAllSwap([this](const FAgent& Agent)
+	{
+		if (Agent.Controller.IsValid()) return false;
+		RemovePawnPrerequisites(Agent.Pawn.Get());
+		return true;
+	});
+
+	// gather
+	BatchAgents.Reset();
+	BatchViewLocations.Reset();
+	BatchFocalPoints.Reset();
+	BatchCurrentRotations.Reset();
+	BatchPawnRotations.Reset();
+	BatchFlags.Reset();
+	for (int32 AgentIndex = 0; AgentIndex < Agents.Num(); ++AgentIndex)
+	{
+		AUHLStateTreeAIController* Controller = Agents[AgentIndex].Controller.Get();
+		APawn* Pawn = Controller->GetPawn();
+		if (!Pawn) continue;
+
+		// possessed a different pawn since registering
+		if (Agents[AgentIndex].Pawn != Pawn)
+		{
+			RemovePawnPrerequisites(Agents[AgentIndex].Pawn.Get());
+			Agents[AgentIndex].Pawn = Pawn;
+			AddPawnPrerequisites(Pawn);
+		}
+
+		const FVector FocalPoint = Controller->GetFocalPoint();
+		uint8 Flags = 0;
+		Flags |= FAISystem::IsValidLocation(FocalPoint) ? HasFocalPoint : 0;
+		// same as AAIController, don't pitch the view unless looking at another pawn
+		Flags |= Cast<APawn>(Controller->GetFocusActor()) ? AllowPitch : 0;
+		Flags |= Controller->bSetControlRotationFromPawnOrientation ? FromPawnOrientation : 0;
+
+		BatchAgents.Add(AgentIndex);
+		BatchViewLocations.Add(Pawn->GetPawnViewLocation());
+		BatchFocalPoints.Add(FocalPoint);
+		BatchCurrentRotations.Add(Controller->GetControlRotation());
+		BatchPawnRotations.Add(Pawn->GetActorRotation());
+		BatchFlags.Add(Flags);
+	}
+
+	// compute
+	const int32 Num = BatchAgents.Num();
+	BatchResults.SetNumUninitialized(Num, EAllowShrinking::No);
+	auto ComputeRotation = [this, DeltaTime](int32 Index)
+	{
+		const uint8 Flags = BatchFlags[Index];
+		FRotator Rotation = BatchCurrentRotations[Index];
+		if (Flags & HasFocalPoint)
+		{
+			Rotation = (BatchFocalPoints[Index] - BatchViewLocations[Index]).Rotation();
+		}
+		else if (Flags & FromPawnOrientation)
+		{
+			Rotation = BatchPawnRotations[Index];
+		}
+		if (!(Flags & AllowPitch))
+		{
+			Rotation.Pitch = 0.0f;
+		}
+
+		const float InterpSpeed = Agents[BatchAgents[Index]].InterpSpeed;
+		if (InterpSpeed > 0.0f && (Flags & HasFocalPoint))
+		{
+			Rotation = FMath::RInterpConstantTo(BatchCurrentRotations[Index], Rotation, DeltaTime, InterpSpeed);
+		}
+		BatchResults[Index] = Rotation;
+	};
+	if (ParallelBatchSize > 0 && Num >= ParallelBatchSize)
+	{
+		ParallelFor(Num, ComputeRotation);
+	}
+	else
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			ComputeRotation(Index);
+		}
+	}
+
+	// apply
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		AUHLStateTreeAIController* Controller = Agents[BatchAgents[Index]].Controller.Get();
+		APawn* Pawn = Controller->GetPawn();
+		const FRotator& Rotation = BatchResults[Index];
+
+		Controller->SetControlRotation(Rotation);
+		if (!BatchPawnRotations[Index].Equals(Rotation, 1e-3f))
+		{
+			Pawn->FaceRotation(Rotation, DeltaTime);
+		}
+	}
+}
@@ -0,0 +1,93 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Subsystems/UHLStateTreeInstancePoolSubsystem.h"
+
+#include "StateTree.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Core/UHLStateTreeMemory.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLStateTreeInstancePoolSubsystem)
+
+namespace UHLStateTreeInstancePool
+{
+	static int32 MaxPerTree = 64;
+	static FAutoConsoleVariableRef CVarMaxPerTree(
+		TEXT("uhl.StateTree.InstancePool.MaxPerTree"),
+		MaxPerTree,
+		TEXT("Most instance data kept per StateTree asset by the UHL instance data pool, 0 disables pooling."));
+}
+
+UUHLStateTreeInstancePoolSubsystem* UUHLStateTreeInstancePoolSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<UUHLStateTreeInstancePoolSubsystem>() : nullptr;
+}
+
+bool UUHLStateTreeInstancePoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UUHLStateTreeInstancePoolSubsystem::Deinitialize()
+{
+	Pools.Empty();
+	Stats.PooledInstances = 0;
+
+	Super::Deinitialize();
+}
+
+bool UUHLStateTreeInstancePoolSubsystem::Acquire(const UStateTree* StateTree, FStateTreeInstanceData& InOutInstanceData)
+{
+	if (!StateTree) return false;
+
+	Stats.Acquired++;
+	TArray<FStateTreeInstanceData>* Pool = Pools.Find(StateTree);
+	if (!Pool || Pool->Num() == 0) return false;
+
+	// swapping moves the grown instance buffers instead of copying them
+	Swap(InOutInstanceData, Pool->Last());
+	Pool->Pop(EAllowShrinking::No);
+
+	Stats.Reused++;
+	Stats.PooledInstances--;
+	return true;
+}
+
+void UUHLStateTreeInstancePoolSubsystem::Release(const UStateTree* StateTree, FStateTreeInstanceData& InOutInstanceData)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_InstanceData);
+	if (!StateTree) return;
+
+	TArray<FStateTreeInstanceData>& Pool = Pools.FindOrAdd(StateTree);
+	if (Pool.Num() >= UHLStateTreeInstancePool::MaxPerTree) return;
+
+	// node instances are dropped here, pooled data doesn't keep objects alive
+	InOutInstanceData.Reset();
+	Swap(InOutInstanceData, Pool.AddDefaulted_GetRef());
+	Stats.PooledInstances++;
+}
+
+void UUHLStateTreeInstancePoolSubsystem::Prewarm(const UStateTree* StateTree, int32 Count)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree_InstanceData);
+	if (!StateTree) return;
+
+	TArray<FStateTreeInstanceData>& Pool = Pools.FindOrAdd(StateTree);
+	const int32 Target = FMath::Min(Count, UHLStateTreeInstancePool::MaxPerTree);
+	Pool.Reserve(Target);
+	const FStateTreeInstanceData& DefaultInstanceData = StateTree->GetDefaultInstanceData();
+	while (Pool.Num() < Target)
+	{
+		// grows the storage to the tree's layout, then resets it like Release does, StartLogic reuses the buffers
+		FStateTreeInstanceData& InstanceData = Pool.AddDefaulted_GetRef();
+		InstanceData.CopyFrom(*this, DefaultInstanceData);
+		InstanceData.Reset();
+		Stats.PooledInstances++;
+	}
+}
+
+int32 UUHLStateTreeInstancePoolSubsystem::GetPooledCount(const UStateTree* StateTree) const
+{
+	const TArray<FStateTreeInstanceData>* Pool = StateTree ? Pools.Find(StateTree) : nullptr;
+	return Pool ? Pool->Num() : 0;
+}
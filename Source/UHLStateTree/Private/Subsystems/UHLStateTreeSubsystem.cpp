@@ -0,0 +1,378 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#include "Subsystems/UHLStateTreeSubsystem.h"
+
+#include "Components/UHLStateTreeAIComponent.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Core/UHLStateTreeMemory.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(UHLStateTreeSubsystem)
+
+namespace UHLStateTreeScheduler
+{
+	static float TickBudgetMs = 0.0f;
+	static FAutoConsoleVariableRef CVarTickBudgetMs(
+		TEXT("uhl.StateTree.TickBudgetMs"),
+		TickBudgetMs,
+		TEXT("Milliseconds per frame UUHLStateTreeSubsystem may spend ticking UHL StateTree components, 0 lets components tick themselves.\n")
+		TEXT("Takes effect for components that start logic after the change."));
+
+	static float MaxTickStaleness = 0.5f;
+	static FAutoConsoleVariableRef CVarMaxTickStaleness(
+		TEXT("uhl.StateTree.MaxTickStaleness"),
+		MaxTickStaleness,
+		TEXT("Seconds past its tick rate interval after which a scheduled agent is ticked even if the frame budget is spent, 0 disables."));
+
+	static float SignificanceUpdateInterval = 0.25f;
+	static FAutoConsoleVariableRef CVarSignificanceUpdateInterval(
+		TEXT("uhl.StateTree.SignificanceUpdateInterval"),
+		SignificanceUpdateInterval,
+		TEXT("Seconds between significance evaluations of UHL StateTree agents."));
+
+	static int32 ParallelMinBatch = 4;
+	static FAutoConsoleVariableRef CVarParallelMinBatch(
+		TEXT("uhl.StateTree.ParallelTick.MinBatch"),
+		ParallelMinBatch,
+		TEXT("Parallel agents due in a frame below which their trees tick on the game thread instead of workers."));
+
+	/** Agent ticks this frame regardless of the budget */
+	static bool IsForced(const UUHLStateTreeAIComponent* Component, bool bCritical, double SinceLastTick)
+	{
+		if (Component->IsSleeping()) return false;
+		if (bCritical || Component->HasImmediateTickRequest()) return true;
+		return MaxTickStaleness > 0.0f && SinceLastTick >= Component->GetTickRateInterval() + MaxTickStaleness;
+	}
+}
+
+UUHLStateTreeSubsystem* UUHLStateTreeSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<UUHLStateTreeSubsystem>() : nullptr;
+}
+
+bool UUHLStateTreeSubsystem::IsSchedulingEnabled()
+{
+	return UHLStateTreeScheduler::TickBudgetMs > 0.0f;
+}
+
+bool UUHLStateTreeSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UUHLStateTreeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UUHLStateTreeSubsystem, STATGROUP_Tickables);
+}
+
+void UUHLStateTreeSubsystem::AddAgent(FPriorityClass& Class, UUHLStateTreeAIComponent* Component)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree);
+	FAgent& Agent = Class.Agents.AddDefaulted_GetRef();
+	Agent.Component = Component;
+	Agent.LastTickTime = GetWorld()->GetTimeSeconds();
+	Agent.bWasTickEnabled = Component->IsComponentTickEnabled();
+	Component->SetComponentTickEnabled(false);
+}
+
+bool UUHLStateTreeSubsystem::RemoveAgent(FPriorityClass& Class, UUHLStateTreeAIComponent* Component)
+{
+	const int32 Index = Class.Agents.IndexOfByPredicate([Component](const FAgent& Item) { return Item.Component == Component; });
+	if (Index == INDEX_NONE) return false;
+
+	if (Component && Class.Agents[Index].bWasTickEnabled)
+	{
+		Component->SetComponentTickEnabled(true);
+	}
+	if (bTickingAgents)
+	{
+		// removed after the frame
+		Class.Agents[Index].Component.Reset();
+		return true;
+	}
+	// keeps round-robin order of the remaining agents
+	Class.Agents.RemoveAt(Index);
+	if (Class.Cursor > Index)
+	{
+		--Class.Cursor;
+	}
+	return true;
+}
+
+void UUHLStateTreeSubsystem::RegisterComponent(UUHLStateTreeAIComponent* Component, EUHLStateTreeTickPriority Priority)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree);
+	if (!Component || Priority == EUHLStateTreeTickPriority::MAX) return;
+
+	UnregisterComponent(Component);
+	if (bTickingAgents)
+	{
+		PendingRegistrations.Add({Component, Priority, false});
+		return;
+	}
+	AddAgent(Classes[static_cast<int32>(Priority)], Component);
+}
+
+void UUHLStateTreeSubsystem::RegisterParallelComponent(UUHLStateTreeAIComponent* Component)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree);
+	if (!Component) return;
+
+	UnregisterComponent(Component);
+	if (bTickingAgents)
+	{
+		PendingRegistrations.Add({Component, EUHLStateTreeTickPriority::Normal, true});
+		return;
+	}
+	AddAgent(ParallelClass, Component);
+}
+
+void UUHLStateTreeSubsystem::UnregisterComponent(UUHLStateTreeAIComponent* Component)
+{
+	PendingRegistrations.RemoveAll([Component](const FPendingRegistration& Item) { return Item.Component == Component; });
+
+	if (RemoveAgent(ParallelClass, Component)) return;
+	for (FPriorityClass& Class : Classes)
+	{
+		if (RemoveAgent(Class, Component)) return;
+	}
+}
+
+void UUHLStateTreeSubsystem::RegisterSleeping(UUHLStateTreeAIComponent* Component)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree);
+	if (Component)
+	{
+		SleepingAgents.AddUnique(Component);
+	}
+}
+
+void UUHLStateTreeSubsystem::UnregisterSleeping(UUHLStateTreeAIComponent* Component)
+{
+	SleepingAgents.RemoveSwap(Component);
+}
+
+void UUHLStateTreeSubsystem::WakeUpSleepingAgents(double Now)
+{
+	SleepingAgents.RemoveAllSwap([](const TWeakObjectPtr<UUHLStateTreeAIComponent>& Component) { return !Component.IsValid(); });
+
+	// waking up unregisters from SleepingAgents
+	AgentsToWakeUp.Reset();
+	for (const TWeakObjectPtr<UUHLStateTreeAIComponent>& Component : SleepingAgents)
+	{
+		if (Component->ShouldWakeUp(Now))
+		{
+			AgentsToWakeUp.Add(Component.Get());
+		}
+	}
+	for (UUHLStateTreeAIComponent* Component : AgentsToWakeUp)
+	{
+		Component->WakeUp();
+	}
+}
+
+void UUHLStateTreeSubsystem::RegisterSignificance(UUHLStateTreeAIComponent* Component)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree);
+	if (Component)
+	{
+		SignificanceAgents.AddUnique(Component);
+		// new agents are rated on the next frame
+		NextSignificanceUpdateTime = 0.0;
+	}
+}
+
+void UUHLStateTreeSubsystem::UnregisterSignificance(UUHLStateTreeAIComponent* Component)
+{
+	SignificanceAgents.RemoveSwap(Component);
+}
+
+void UUHLStateTreeSubsystem::UpdateSignificance(double Now)
+{
+	if (Now < NextSignificanceUpdateTime) return;
+	NextSignificanceUpdateTime = Now + UHLStateTreeScheduler::SignificanceUpdateInterval;
+
+	SignificanceAgents.RemoveAllSwap([](const TWeakObjectPtr<UUHLStateTreeAIComponent>& Component) { return !Component.IsValid(); });
+	if (SignificanceAgents.Num() == 0) return;
+
+	ViewLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	for (const TWeakObjectPtr<UUHLStateTreeAIComponent>& Component : SignificanceAgents)
+	{
+		Component->UpdateSignificance(ViewLocations, Now);
+	}
+}
+
+void UUHLStateTreeSubsystem::Deinitialize()
+{
+	for (FPriorityClass& Class : Classes)
+	{
+		for (const FAgent& Agent : Class.Agents)
+		{
+			if (UUHLStateTreeAIComponent* Component = Agent.Component.Get())
+			{
+				Component->SetComponentTickEnabled(Agent.bWasTickEnabled);
+			}
+		}
+		Class.Agents.Reset();
+		Class.Cursor = 0;
+	}
+	for (const FAgent& Agent : ParallelClass.Agents)
+	{
+		if (UUHLStateTreeAIComponent* Component = Agent.Component.Get())
+		{
+			Component->SetComponentTickEnabled(Agent.bWasTickEnabled);
+		}
+	}
+	ParallelClass.Agents.Reset();
+
+	Super::Deinitialize();
+}
+
+void UUHLStateTreeSubsystem::TickAgent(FAgent& Agent, double Now)
+{
+	UUHLStateTreeAIComponent* Component = Agent.Component.Get();
+	if (!Component) return;
+
+	const float DeltaTime = static_cast<float>(Now - Agent.LastTickTime);
+	Agent.LastTickTime = Now;
+	Component->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+	++Stats.TickedAgents;
+}
+
+void UUHLStateTreeSubsystem::TickParallelAgents(double Now)
+{
+	ParallelBatch.Reset();
+	for (FAgent& Agent : ParallelClass.Agents)
+	{
+		UUHLStateTreeAIComponent* Component = Agent.Component.Get();
+		if (!Component || Component->IsSleeping()) continue;
+
+		// swapping restarts the tree, that can't run on workers. Agent is re-registered for the new tree
+		if (Component->IsStateTreeSwapReady())
+		{
+			Component->ApplyPendingStateTreeSwap();
+			continue;
+		}
+
+		const double SinceLastTick = Now - Agent.LastTickTime;
+		if (SinceLastTick > 0.0 && (Component->HasImmediateTickRequest() || SinceLastTick >= Component->GetTickRateInterval()))
+		{
+			ParallelBatch.Emplace(Component, static_cast<float>(SinceLastTick));
+			Agent.LastTickTime = Now;
+		}
+	}
+	if (ParallelBatch.Num() == 0) return;
+
+	// world doesn't change while workers run, game thread work of the trees is deferred into their command buffers
+	ParallelFor(ParallelBatch.Num(), [this](int32 Index)
+	{
+		ParallelBatch[Index].Key->TickParallel(ParallelBatch[Index].Value);
+	}, ParallelBatch.Num() < UHLStateTreeScheduler::ParallelMinBatch ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	for (const TPair<UUHLStateTreeAIComponent*, float>& Item : ParallelBatch)
+	{
+		Item.Key->FinishParallelTick();
+	}
+	Stats.ParallelAgents = ParallelBatch.Num();
+	Stats.TickedAgents += ParallelBatch.Num();
+}
+
+void UUHLStateTreeSubsystem::Tick(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(UHLStateTree);
+	using namespace UHLStateTreeScheduler;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	UpdateSignificance(Now);
+	WakeUpSleepingAgents(Now);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double BudgetEndTime = StartTime + TickBudgetMs / 1000.0;
+
+	Stats = FUHLStateTreeTickStats();
+	for (FPriorityClass& Class : Classes)
+	{
+		Class.Agents.RemoveAll([](const FAgent& Agent) { return !Agent.Component.IsValid(); });
+		Class.Cursor = Class.Agents.Num() > 0 ? Class.Cursor % Class.Agents.Num() : 0;
+		Stats.RegisteredAgents += Class.Agents.Num();
+	}
+	ParallelClass.Agents.RemoveAllSwap([](const FAgent& Agent) { return !Agent.Component.IsValid(); });
+	Stats.RegisteredAgents += ParallelClass.Agents.Num();
+
+	bTickingAgents = true;
+
+	TickParallelAgents(Now);
+
+	// critical agents and agents stale for too long don't wait for the budget
+	for (int32 ClassIndex = 0; ClassIndex < Classes.Num(); ++ClassIndex)
+	{
+		const bool bCritical = ClassIndex == static_cast<int32>(EUHLStateTreeTickPriority::Critical);
+		for (FAgent& Agent : Classes[ClassIndex].Agents)
+		{
+			const UUHLStateTreeAIComponent* Component = Agent.Component.Get();
+			if (Component && IsForced(Component, bCritical, Now - Agent.LastTickTime))
+			{
+				Stats.ForcedAgents += bCritical ? 0 : 1;
+				TickAgent(Agent, Now);
+			}
+		}
+	}
+
+	// round-robin within budget, higher classes first
+	for (int32 ClassIndex = static_cast<int32>(EUHLStateTreeTickPriority::High); ClassIndex < Classes.Num(); ++ClassIndex)
+	{
+		FPriorityClass& Class = Classes[ClassIndex];
+		for (int32 Visited = 0; Visited < Class.Agents.Num() && FPlatformTime::Seconds() < BudgetEndTime; ++Visited)
+		{
+			FAgent& Agent = Class.Agents[Class.Cursor];
+			Class.Cursor = (Class.Cursor + 1) % Class.Agents.Num();
+			// skips agents ticked as forced this frame and agents whose tick rate isn't due yet
+			const UUHLStateTreeAIComponent* Component = Agent.Component.Get();
+			if (Component && !Component->IsSleeping() && Agent.LastTickTime < Now && Now - Agent.LastTickTime >= Component->GetTickRateInterval())
+			{
+				TickAgent(Agent, Now);
+			}
+		}
+	}
+
+	bTickingAgents = false;
+	const TArray<FPendingRegistration> Registrations = MoveTemp(PendingRegistrations);
+	PendingRegistrations.Reset();
+	for (const FPendingRegistration& Pending : Registrations)
+	{
+		if (Pending.bParallel)
+		{
+			RegisterParallelComponent(Pending.Component.Get());
+		}
+		else
+		{
+			RegisterComponent(Pending.Component.Get(), Pending.Priority);
+		}
+	}
+
+	for (const FPriorityClass& Class : Classes)
+	{
+		for (const FAgent& Agent : Class.Agents)
+		{
+			const UUHLStateTreeAIComponent* Component = Agent.Component.Get();
+			if (!Component || Component->IsSleeping()) continue;
+			const float Staleness = static_cast<float>(Now - Agent.LastTickTime) - Component->GetTickRateInterval();
+			Stats.WorstStaleness = FMath::Max(Stats.WorstStaleness, Staleness);
+		}
+	}
+	Stats.SleepingAgents = SleepingAgents.Num();
+	Stats.UsedMs = static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
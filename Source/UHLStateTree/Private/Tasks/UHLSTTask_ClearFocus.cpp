@@ -7,6 +7,8 @@
 #include "GameFramework/Actor.h"
 #include "DrawDebugHelpers.h"
 #include "Components/UHLStateTreeAIComponent.h"
+#include "Core/UHLFocusArbiter.h"
+#include "Core/UHLStateTreeProfiling.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(UHLSTTask_ClearFocus)
 
@@ -14,23 +16,53 @@
 
 EStateTreeRunStatus FUHLSTTask_ClearFocus::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
 {
-	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
-	
+	UHL_STATETREE_NODE_SCOPE(ClearFocus);
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+	if (!InstanceData.FocusOwner)
+	{
+		InstanceData.FocusOwner = UHLFocus::MakeOwnerKey();
+	}
+
 	const UWorld* World = Context.GetWorld();
 
 	// Reference actor is not required (offset will be used as a global world location)
 	// but a valid world is required.
 	if (World == nullptr)
 	{
-		return EStateTreeRunStatus::Failed;
+		return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 	}
 
 	AAIController* AIController = InstanceData.AIController;
-	if (!AIController) return EStateTreeRunStatus::Failed;
+	if (!AIController) return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 
-	AIController->ClearFocus(static_cast<uint8>(InstanceData.FocusPriority));
+	const uint8 FocusSlot = static_cast<uint8>(InstanceData.FocusPriority);
+	if (FUHLFocusArbiter* Arbiter = UHLFocus::FindArbiter(AIController))
+	{
+		Arbiter->ClearRequests(FocusSlot, InstanceData.RequestPriority);
+		if (!InstanceData.bFinishTask)
+		{
+			// empty request holds the slot cleared against lower priorities
+			FUHLFocusRequest ClearRequest;
+			ClearRequest.Priority = InstanceData.RequestPriority;
+			Arbiter->SubmitRequest(InstanceData.FocusOwner, FocusSlot, ClearRequest);
+		}
+	}
+	else
+	{
+		AIController->ClearFocus(FocusSlot);
+	}
+
+	return UHLNodeScope.EnterStatus(Context.GetOwner(), InstanceData.bFinishTask ? EStateTreeRunStatus::Succeeded : EStateTreeRunStatus::Running);
+}
 
-	return InstanceData.bFinishTask ? EStateTreeRunStatus::Succeeded : EStateTreeRunStatus::Running;
+void FUHLSTTask_ClearFocus::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	UHL_STATETREE_NODE_SCOPE(ClearFocus);
+	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+	if (FUHLFocusArbiter* Arbiter = UHLFocus::FindArbiter(InstanceData.AIController))
+	{
+		Arbiter->ReleaseRequest(InstanceData.FocusOwner, static_cast<uint8>(InstanceData.FocusPriority));
+	}
 }
 
 #if WITH_EDITOR
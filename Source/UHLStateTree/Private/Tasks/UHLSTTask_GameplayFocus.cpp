@@ -7,6 +7,8 @@
 #include "GameFramework/Actor.h"
 #include "DrawDebugHelpers.h"
 #include "Components/UHLStateTreeAIComponent.h"
+#include "Core/UHLFocusArbiter.h"
+#include "Core/UHLStateTreeProfiling.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(UHLSTTask_GameplayFocus)
 
@@ -14,44 +16,66 @@
 
 EStateTreeRunStatus FUHLSTTask_GameplayFocus::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
 {
-	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
-	
+	UHL_STATETREE_NODE_SCOPE(GameplayFocus);
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+	if (!InstanceData.FocusOwner)
+	{
+		InstanceData.FocusOwner = UHLFocus::MakeOwnerKey();
+	}
+
 	const UWorld* World = Context.GetWorld();
 
 	// Reference actor is not required (offset will be used as a global world location)
 	// but a valid world is required.
 	if (World == nullptr)
 	{
-		return EStateTreeRunStatus::Failed;
+		return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 	}
 
 	AAIController* AIController = InstanceData.AIController;
-	if (!AIController) return EStateTreeRunStatus::Failed;
+	if (!AIController) return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 
-	AIController->ClearFocus(static_cast<uint8>(InstanceData.FocusPriority));
+	if (!InstanceData.bEnable)
+	{
+		UHLFocus::ReleaseFocus(AIController, InstanceData.FocusOwner, static_cast<uint8>(InstanceData.FocusPriority));
+	}
 
-	return EStateTreeRunStatus::Running;
+	return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Running);
 }
 
 EStateTreeRunStatus FUHLSTTask_GameplayFocus::Tick(
 	FStateTreeExecutionContext& Context, const float DeltaTime) const
 {
+	UHL_STATETREE_NODE_SCOPE(GameplayFocus);
 	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 	if (!InstanceData.AIController || !InstanceData.bEnable)
 	{
-		return FStateTreeTaskCommonBase::Tick(Context, DeltaTime);
+		return UHLNodeScope.TickStatus(Context.GetOwner(), FStateTreeTaskCommonBase::Tick(Context, DeltaTime));
 	}
 
+	// resubmitting the same target doesn't touch the controller
 	if (InstanceData.ActorToFocus)
 	{
-		InstanceData.AIController->SetFocus(InstanceData.ActorToFocus, static_cast<uint8>(InstanceData.FocusPriority));	
+		UHLFocus::SetFocus(InstanceData.AIController, InstanceData.FocusOwner, InstanceData.ActorToFocus, static_cast<uint8>(InstanceData.FocusPriority), InstanceData.RequestPriority);
 	}
 	else
 	{
-		InstanceData.AIController->SetFocalPoint(InstanceData.LocationToFocus, static_cast<uint8>(InstanceData.FocusPriority));	
+		UHLFocus::SetFocalPoint(InstanceData.AIController, InstanceData.FocusOwner, InstanceData.LocationToFocus, static_cast<uint8>(InstanceData.FocusPriority), InstanceData.RequestPriority);
 	}
 	
-	return FStateTreeTaskCommonBase::Tick(Context, DeltaTime);
+	return UHLNodeScope.TickStatus(Context.GetOwner(), FStateTreeTaskCommonBase::Tick(Context, DeltaTime));
+}
+
+void FUHLSTTask_GameplayFocus::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	UHL_STATETREE_NODE_SCOPE(GameplayFocus);
+	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	// focus set directly on the controller stays after exit, arbitrated focus goes back to other requests
+	if (FUHLFocusArbiter* Arbiter = UHLFocus::FindArbiter(InstanceData.AIController))
+	{
+		Arbiter->ReleaseRequest(InstanceData.FocusOwner, static_cast<uint8>(InstanceData.FocusPriority));
+	}
 }
 
 #if WITH_EDITOR
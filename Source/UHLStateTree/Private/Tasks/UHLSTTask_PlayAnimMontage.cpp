@@ -3,10 +3,17 @@
 #include "Tasks/UHLSTTask_PlayAnimMontage.h"
 
 #include "StateTreeExecutionContext.h"
+#include "StateTreeAsyncExecutionContext.h"
 #include "GameFramework/Character.h"
 #include "Animation/AnimInstance.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
 #include "Net/UHLMontageReplicatorObject.h"
+#include "Components/UHLStateTreeAIComponent.h"
+#include "AIController.h"
 #include "StateTreeLinker.h"
+#include "UHLStateTree.h"
+#include "Core/UHLStateTreeProfiling.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(UHLSTTask_PlayAnimMontage)
 
@@ -21,6 +28,24 @@ USkeletalMeshComponent* FUHLSTTask_PlayAnimMontage::ResolveMesh(const FInstanceD
 	return InstanceData.Character ? InstanceData.Character->GetMesh() : nullptr;
 }
 
+UAnimMontage* FUHLSTTask_PlayAnimMontage::ResolveMontage(const FInstanceDataType& InstanceData) const
+{
+	if (InstanceData.AnimMontage)
+	{
+		return InstanceData.AnimMontage;
+	}
+	if (InstanceData.SoftAnimMontage.IsNull())
+	{
+		return nullptr;
+	}
+	if (UAnimMontage* LoadedMontage = InstanceData.SoftAnimMontage.Get())
+	{
+		return LoadedMontage;
+	}
+	UE_LOG(LogUHLStateTree, Warning, TEXT("[UHLSTTask_PlayAnimMontage] %s wasn't preloaded, loading synchronously"), *InstanceData.SoftAnimMontage.ToString());
+	return InstanceData.SoftAnimMontage.LoadSynchronous();
+}
+
 bool FUHLSTTask_PlayAnimMontage::IsMontagePlaying(USkeletalMeshComponent* Mesh, const UAnimMontage* Montage) const
 {
 	if (!Mesh) return false;
@@ -29,6 +54,19 @@ bool FUHLSTTask_PlayAnimMontage::IsMontagePlaying(USkeletalMeshComponent* Mesh,
 	return AnimInstance->Montage_IsPlaying(Montage);
 }
 
+/** Finishes the task and wakes the tree up, so reduced tick rates don't delay the transition. */
+static void UHL_FinishMontageTask(
+	const FStateTreeWeakExecutionContext& WeakContext,
+	const TWeakObjectPtr<UUHLStateTreeAIComponent>& WeakComponent,
+	EStateTreeFinishTaskType FinishType)
+{
+	WeakContext.FinishTask(FinishType);
+	if (UUHLStateTreeAIComponent* Component = WeakComponent.Get())
+	{
+		Component->RequestImmediateTick();
+	}
+}
+
 static void UHL_BindMontageDelegates(
     FStateTreeExecutionContext& Context,
     UAnimInstance* AnimInstance,
@@ -37,41 +75,207 @@ static void UHL_BindMontageDelegates(
 {
 	if (!AnimInstance || !Montage) return;
 	InstanceData.BoundAnimInstance = AnimInstance;
+
+	// Delegates outlive this call and instance memory may be relocated, so capture
+	// only the weak context and finish settings by value
+	const FStateTreeWeakExecutionContext WeakContext = Context.MakeWeakExecutionContext();
+	const TWeakObjectPtr<UUHLStateTreeAIComponent> WeakComponent = UUHLStateTreeAIComponent::FindForController(Cast<AAIController>(Context.GetOwner()));
+	const EStateTreeFinishTaskType FinishType = InstanceData.bSucceededResult ? EStateTreeFinishTaskType::Succeeded : EStateTreeFinishTaskType::Failed;
+	const bool bFinishOnCompleted = InstanceData.bFinishTaskOnCompleted;
+	const bool bFinishOnInterrupted = InstanceData.bFinishTaskOnInterrupted;
+	const bool bFinishOnBlendOut = InstanceData.bFinishTaskOnBlendOut;
+
     FOnMontageEnded Ended;
-    Ended.BindLambda([&InstanceData](UAnimMontage* InMontage, bool bInterrupted)
+    Ended.BindLambda([WeakContext, WeakComponent, FinishType, bFinishOnCompleted, bFinishOnInterrupted](UAnimMontage* InMontage, bool bInterrupted)
 	{
-        InstanceData.bInterruptedTriggered |= bInterrupted;
-        InstanceData.bCompletedTriggered |= !bInterrupted;
+        if (bInterrupted ? bFinishOnInterrupted : bFinishOnCompleted)
+        {
+            UHL_FinishMontageTask(WeakContext, WeakComponent, FinishType);
+        }
 	});
 	AnimInstance->Montage_SetEndDelegate(Ended, Montage);
 
     FOnMontageBlendingOutStarted BlendOut;
-    BlendOut.BindLambda([&InstanceData](UAnimMontage* InMontage, bool bInterrupted)
+    BlendOut.BindLambda([WeakContext, WeakComponent, FinishType, bFinishOnInterrupted, bFinishOnBlendOut](UAnimMontage* InMontage, bool bInterrupted)
 	{
-        InstanceData.bBlendOutTriggered = true;
-        InstanceData.bInterruptedTriggered |= bInterrupted;
+        if (bFinishOnBlendOut || (bInterrupted && bFinishOnInterrupted))
+        {
+            UHL_FinishMontageTask(WeakContext, WeakComponent, FinishType);
+        }
 	});
 	AnimInstance->Montage_SetBlendingOutDelegate(BlendOut, Montage);
+
+	if (InstanceData.NotifyEvents.Num() > 0)
+	{
+		if (const FAnimMontageInstance* MontageInstance = AnimInstance->GetActiveInstanceForMontage(Montage))
+		{
+			if (!InstanceData.NotifyListener)
+			{
+				InstanceData.NotifyListener = NewObject<UUHLMontageNotifyListener>(Context.GetOwner());
+			}
+			InstanceData.NotifyListener->Bind(AnimInstance, MontageInstance->GetInstanceID(), InstanceData.NotifyEvents, WeakContext);
+		}
+	}
+}
+
+/**
+ * Play time in montage seconds from StartPosition or StartSection until the montage ends, following section links.
+ * Returns a negative value if sections loop and montage never ends by itself.
+ */
+static float UHL_GetMontageRemainingLength(const UAnimMontage* Montage, float StartPosition, FName StartSection)
+{
+	int32 SectionIndex = StartSection != NAME_None ? Montage->GetSectionIndex(StartSection) : Montage->GetSectionIndexFromPosition(StartPosition);
+	if (SectionIndex == INDEX_NONE)
+	{
+		return FMath::Max(Montage->GetPlayLength() - StartPosition, 0.0f);
+	}
+
+	float Position = StartSection != NAME_None ? Montage->GetAnimCompositeSection(SectionIndex).GetTime() : StartPosition;
+	float Length = 0.0f;
+	TBitArray<> VisitedSections(false, Montage->CompositeSections.Num());
+	while (SectionIndex != INDEX_NONE)
+	{
+		if (VisitedSections[SectionIndex]) return -1.0f;
+		VisitedSections[SectionIndex] = true;
+
+		float SectionStart = 0.0f;
+		float SectionEnd = 0.0f;
+		Montage->GetSectionStartAndEndTime(SectionIndex, SectionStart, SectionEnd);
+		Length += FMath::Max(SectionEnd - Position, 0.0f);
+
+		// montage ends at the end of a section without a next section
+		const FName NextSection = Montage->GetAnimCompositeSection(SectionIndex).NextSectionName;
+		SectionIndex = NextSection != NAME_None ? Montage->GetSectionIndex(NextSection) : INDEX_NONE;
+		if (SectionIndex != INDEX_NONE)
+		{
+			Position = Montage->GetAnimCompositeSection(SectionIndex).GetTime();
+		}
+	}
+	return Length;
+}
+
+/** Replicator of the character, cached by the UHL component running the tree when there is one */
+static UUHLMontageReplicatorObject* UHL_GetMontageReplicator(FStateTreeExecutionContext& Context, ACharacter* Character)
+{
+	if (UUHLStateTreeAIComponent* Component = UUHLStateTreeAIComponent::FindForController(Cast<AAIController>(Context.GetOwner())))
+	{
+		return Component->GetMontageReplicator(Character);
+	}
+	return UUHLMontageReplicatorObject::GetOrCreate(Character);
+}
+
+/**
+ * Replicates the montage without playing it on the server and sets a timer that finishes the task
+ * where blend out or completion delegates would have. Returns false if the montage can't be simulated,
+ * i.e. it has root motion, plays on the main mesh or can't be sent as a montage op.
+ */
+static bool UHL_PlayServerSimulatedMontage(
+	FStateTreeExecutionContext& Context,
+	USkeletalMeshComponent* Mesh,
+	UAnimMontage* Montage,
+	FUHLSTTask_PlayAnimMontage::FInstanceDataType& InstanceData)
+{
+	// root motion moves the server pawn, the main mesh replicates through ACharacter::RepAnimMontageInfo
+	if (Montage->HasRootMotion() || Mesh == InstanceData.Character->GetMesh()) return false;
+
+	UWorld* World = InstanceData.Character->GetWorld();
+	const float EffectiveRate = InstanceData.PlayRate * Montage->RateScale;
+	if (!World || EffectiveRate <= 0.0f) return false;
+
+	UUHLMontageReplicatorObject* Replicator = UHL_GetMontageReplicator(Context, InstanceData.Character);
+	if (!Replicator) return false;
+
+	const bool bSent = Replicator->PlayMontage(
+		Mesh,
+		Montage,
+		InstanceData.PlayRate,
+		InstanceData.StartingPosition,
+		InstanceData.StartingSection,
+		InstanceData.NetDelivery,
+		InstanceData.bShouldStopAllMontages ? TOptional<float>(0.25f) : TOptional<float>(),
+		false);
+	if (!bSent) return false;
+
+	const float RemainingLength = UHL_GetMontageRemainingLength(Montage, InstanceData.StartingPosition, InstanceData.StartingSection);
+	if (RemainingLength < 0.0f)
+	{
+		// looping montage, runs until the state is left
+		return true;
+	}
+
+	// auto blend out starts BlendOutTriggerTime (or blend out time) before the end and the montage ends when blend finishes
+	const float EndTime = RemainingLength / EffectiveRate;
+	const float BlendOutTime = Montage->bEnableAutoBlendOut ? Montage->BlendOut.GetBlendTime() : 0.0f;
+	const float BlendOutTriggerTime = !Montage->bEnableAutoBlendOut ? 0.0f
+		: (Montage->BlendOutTriggerTime >= 0.0f ? Montage->BlendOutTriggerTime : BlendOutTime);
+	const float BlendOutStartTime = FMath::Max(EndTime - BlendOutTriggerTime, 0.0f);
+	const float CompletedTime = BlendOutStartTime + BlendOutTime;
+
+	float FinishTime = -1.0f;
+	if (InstanceData.bFinishTaskOnBlendOut)
+	{
+		FinishTime = BlendOutStartTime;
+	}
+	else if (InstanceData.bFinishTaskOnCompleted)
+	{
+		FinishTime = CompletedTime;
+	}
+	if (FinishTime < 0.0f)
+	{
+		return true;
+	}
+
+	const FStateTreeWeakExecutionContext WeakContext = Context.MakeWeakExecutionContext();
+	const TWeakObjectPtr<UUHLStateTreeAIComponent> WeakComponent = UUHLStateTreeAIComponent::FindForController(Cast<AAIController>(Context.GetOwner()));
+	const EStateTreeFinishTaskType FinishType = InstanceData.bSucceededResult ? EStateTreeFinishTaskType::Succeeded : EStateTreeFinishTaskType::Failed;
+	const FTimerDelegate FinishDelegate = FTimerDelegate::CreateLambda([WeakContext, WeakComponent, FinishType]()
+	{
+		UHL_FinishMontageTask(WeakContext, WeakComponent, FinishType);
+	});
+	if (FinishTime > 0.0f)
+	{
+		World->GetTimerManager().SetTimer(InstanceData.FinishTimerHandle, FinishDelegate, FinishTime, false);
+	}
+	else
+	{
+		InstanceData.FinishTimerHandle = World->GetTimerManager().SetTimerForNextTick(FinishDelegate);
+	}
+	return true;
 }
 
 EStateTreeRunStatus FUHLSTTask_PlayAnimMontage::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
 {
+	UHL_STATETREE_NODE_SCOPE(PlayAnimMontage);
 	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
-	if (!InstanceData.Character || !InstanceData.AnimMontage)
+	UAnimMontage* Montage = ResolveMontage(InstanceData);
+	if (!InstanceData.Character || !Montage)
 	{
-		return EStateTreeRunStatus::Failed;
+		return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 	}
+	InstanceData.PlayingMontage = Montage;
 
 	USkeletalMeshComponent* Mesh = ResolveMesh(InstanceData);
 	if (!Mesh)
 	{
-		return EStateTreeRunStatus::Failed;
+		return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
+	}
+
+	// dedicated server doesn't need the pose, completion is computed from montage timing
+	const bool bSimulateOnServer = InstanceData.bSkipAnimationOnDedicatedServer && InstanceData.Character->GetNetMode() == NM_DedicatedServer;
+	if (bSimulateOnServer && InstanceData.NotifyEvents.Num() > 0)
+	{
+		// rejected by Compile, but bound values can still get here
+		UE_LOG(LogUHLStateTree, Error, TEXT("[UHLSTTask_PlayAnimMontage] %s: notify events need the montage played, bSkipAnimationOnDedicatedServer is ignored"), *GetNameSafe(Montage));
+	}
+	else if (bSimulateOnServer && UHL_PlayServerSimulatedMontage(Context, Mesh, Montage, InstanceData))
+	{
+		return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Running);
 	}
 
 	UAnimInstance* AnimInstance = Mesh->GetAnimInstance();
 	if (!AnimInstance)
 	{
-		return EStateTreeRunStatus::Failed;
+		return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 	}
 
     if (InstanceData.bShouldStopAllMontages)
@@ -83,14 +287,8 @@ EStateTreeRunStatus FUHLSTTask_PlayAnimMontage::EnterState(FStateTreeExecutionCo
 		}
 		else
 		{
-            if (InstanceData.Character->HasAuthority())
-            {
-                UUHLMontageReplicatorObject* Replicator = NewObject<UUHLMontageReplicatorObject>(InstanceData.Character);
-                Replicator->Initialize(InstanceData.Character);
-                InstanceData.Character->AddReplicatedSubObject(Replicator);
-                Replicator->Multicast_StopAllMontages(Mesh, 0.25f);
-            }
-            else
+            // with authority the stop is sent together with the play below
+            if (!InstanceData.Character->HasAuthority())
             {
                 AnimInstance->StopAllMontages(0.25f);
             }
@@ -101,72 +299,94 @@ EStateTreeRunStatus FUHLSTTask_PlayAnimMontage::EnterState(FStateTreeExecutionCo
 	if (Mesh == InstanceData.Character->GetMesh())
 	{
 		// Playing on Character's main mesh will replicate to simulated proxies when executed on the server
-		InstanceData.Character->PlayAnimMontage(InstanceData.AnimMontage, InstanceData.PlayRate);
+		InstanceData.Character->PlayAnimMontage(Montage, InstanceData.PlayRate);
 		if (InstanceData.StartingSection != NAME_None)
 		{
-			AnimInstance->Montage_JumpToSection(InstanceData.StartingSection, InstanceData.AnimMontage);
+			AnimInstance->Montage_JumpToSection(InstanceData.StartingSection, Montage);
 		}
 		else if (InstanceData.StartingPosition > 0.0f)
 		{
-			AnimInstance->Montage_SetPosition(InstanceData.AnimMontage, InstanceData.StartingPosition);
+			AnimInstance->Montage_SetPosition(Montage, InstanceData.StartingPosition);
 		}
 	}
     else
 	{
         if (InstanceData.Character->HasAuthority())
         {
-            UUHLMontageReplicatorObject* Replicator = NewObject<UUHLMontageReplicatorObject>(InstanceData.Character);
-            Replicator->Initialize(InstanceData.Character);
-            InstanceData.Character->AddReplicatedSubObject(Replicator);
-            Replicator->Multicast_PlayMontage(
-                Mesh,
-                InstanceData.AnimMontage,
-                InstanceData.PlayRate,
-                InstanceData.StartingPosition,
-                InstanceData.StartingSection);
+            if (UUHLMontageReplicatorObject* Replicator = UHL_GetMontageReplicator(Context, InstanceData.Character))
+            {
+                Replicator->PlayMontage(
+                    Mesh,
+                    Montage,
+                    InstanceData.PlayRate,
+                    InstanceData.StartingPosition,
+                    InstanceData.StartingSection,
+                    InstanceData.NetDelivery,
+                    InstanceData.bShouldStopAllMontages ? TOptional<float>(0.25f) : TOptional<float>());
+            }
         }
         else
         {
-            AnimInstance->Montage_Play(InstanceData.AnimMontage, InstanceData.PlayRate, EMontagePlayReturnType::MontageLength, InstanceData.StartingSection != NAME_None ? 0.0f : InstanceData.StartingPosition, true);
+            AnimInstance->Montage_Play(Montage, InstanceData.PlayRate, EMontagePlayReturnType::MontageLength, InstanceData.StartingSection != NAME_None ? 0.0f : InstanceData.StartingPosition, true);
             if (InstanceData.StartingSection != NAME_None)
             {
-                AnimInstance->Montage_JumpToSection(InstanceData.StartingSection, InstanceData.AnimMontage);
+                AnimInstance->Montage_JumpToSection(InstanceData.StartingSection, Montage);
             }
         }
 	}
 
-    // Bind delegates for completion/interrupt/BlendOut and request transition directly
-    UHL_BindMontageDelegates(Context, AnimInstance, InstanceData.AnimMontage, InstanceData);
-
-	return EStateTreeRunStatus::Running;
-}
+    // Bind delegates for completion/interrupt/BlendOut, they finish the task through the weak context
+    UHL_BindMontageDelegates(Context, AnimInstance, Montage, InstanceData);
 
-EStateTreeRunStatus FUHLSTTask_PlayAnimMontage::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
-{
-	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
-	if ((InstanceData.bFinishTaskOnCompleted && InstanceData.bCompletedTriggered)
-		|| (InstanceData.bFinishTaskOnInterrupted && InstanceData.bInterruptedTriggered)
-		|| (InstanceData.bFinishTaskOnBlendOut && InstanceData.bBlendOutTriggered))
-	{
-		return InstanceData.bSucceededResult ? EStateTreeRunStatus::Succeeded : EStateTreeRunStatus::Failed;
-	}
-	return FStateTreeTaskCommonBase::Tick(Context, DeltaTime);
+	return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Running);
 }
 
 void FUHLSTTask_PlayAnimMontage::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
 {
+	UHL_STATETREE_NODE_SCOPE(PlayAnimMontage);
 	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 	if (UAnimInstance* AnimInstance = InstanceData.BoundAnimInstance.Get())
 	{
 		// Clear bound delegates to avoid dangling refs
 		FOnMontageEnded EmptyEnded;
-		AnimInstance->Montage_SetEndDelegate(EmptyEnded, InstanceData.AnimMontage);
+		AnimInstance->Montage_SetEndDelegate(EmptyEnded, InstanceData.PlayingMontage);
 		FOnMontageBlendingOutStarted EmptyBlendOut;
-		AnimInstance->Montage_SetBlendingOutDelegate(EmptyBlendOut, InstanceData.AnimMontage);
+		AnimInstance->Montage_SetBlendingOutDelegate(EmptyBlendOut, InstanceData.PlayingMontage);
+	}
+	if (InstanceData.NotifyListener)
+	{
+		InstanceData.NotifyListener->Unbind();
+	}
+	if (InstanceData.FinishTimerHandle.IsValid())
+	{
+		if (UWorld* World = Context.GetWorld())
+		{
+			World->GetTimerManager().ClearTimer(InstanceData.FinishTimerHandle);
+		}
+		InstanceData.FinishTimerHandle.Invalidate();
 	}
+	InstanceData.PlayingMontage = nullptr;
 }
 
 #if WITH_EDITOR
+EDataValidationResult FUHLSTTask_PlayAnimMontage::Compile(FStateTreeDataView InstanceDataView, TArray<FText>& ValidationMessages)
+{
+	const FInstanceDataType* InstanceData = InstanceDataView.GetPtr<FInstanceDataType>();
+	if (InstanceData && InstanceData->bSkipAnimationOnDedicatedServer && InstanceData->NotifyEvents.Num() > 0)
+	{
+		ValidationMessages.Add(LOCTEXT("SkippedAnimationNotifies", "Notify Events aren't sent when the montage isn't played, disable Skip Animation On Dedicated Server or remove the events."));
+		return EDataValidationResult::Invalid;
+	}
+
+	// only known when the montage isn't bound, reported as a warning since the task falls back to playing it
+	const UAnimMontage* Montage = InstanceData ? (InstanceData->AnimMontage ? InstanceData->AnimMontage.Get() : InstanceData->SoftAnimMontage.Get()) : nullptr;
+	if (InstanceData && InstanceData->bSkipAnimationOnDedicatedServer && Montage && Montage->HasRootMotion())
+	{
+		ValidationMessages.Add(FText::Format(LOCTEXT("SkippedAnimationRootMotion", "{0} has root motion, it's played on the dedicated server despite Skip Animation On Dedicated Server."), FText::FromString(Montage->GetName())));
+	}
+	return EDataValidationResult::Valid;
+}
+
 FText FUHLSTTask_PlayAnimMontage::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting) const
 {
 	const FInstanceDataType* InstanceData = InstanceDataView.GetPtr<FInstanceDataType>();
@@ -181,7 +401,9 @@ FText FUHLSTTask_PlayAnimMontage::GetDescription(const FGuid& ID, FStateTreeData
 	}
 	else
 	{
-		MontageStr = InstanceData->AnimMontage ? InstanceData->AnimMontage->GetName() : TEXT("None");
+		MontageStr = InstanceData->AnimMontage
+			? InstanceData->AnimMontage->GetName()
+			: (!InstanceData->SoftAnimMontage.IsNull() ? InstanceData->SoftAnimMontage.GetAssetName() : TEXT("None"));
 	}
 
     TArray<FString> Parts;
@@ -211,6 +433,11 @@ FText FUHLSTTask_PlayAnimMontage::GetDescription(const FGuid& ID, FStateTreeData
         Parts.Add(TEXT("StopAll"));
     }
 
+    if (InstanceData->bSkipAnimationOnDedicatedServer)
+    {
+        Parts.Add(TEXT("SkipOnServer"));
+    }
+
     const FString Desc = FString::Join(Parts, TEXT(" | "));
 
 	if (Formatting == EStateTreeNodeFormatting::RichText)
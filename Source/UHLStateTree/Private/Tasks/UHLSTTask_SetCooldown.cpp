@@ -7,6 +7,7 @@
 #include "GameFramework/Actor.h"
 #include "DrawDebugHelpers.h"
 #include "Components/UHLStateTreeAIComponent.h"
+#include "Core/UHLStateTreeProfiling.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(UHLSTTask_SetCooldown)
 
@@ -14,6 +15,7 @@
 
 EStateTreeRunStatus FUHLSTTask_SetCooldown::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
 {
+	UHL_STATETREE_NODE_SCOPE(SetCooldown);
 	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 	
 	const UWorld* World = Context.GetWorld();
@@ -26,27 +28,29 @@ EStateTreeRunStatus FUHLSTTask_SetCooldown::EnterState(FStateTreeExecutionContex
 	// but a valid world is required.
 	if (World == nullptr)
 	{
-		return EStateTreeRunStatus::Failed;
+		return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 	}
 
 	AAIController* AIController = InstanceData.AIController;
-	if (!AIController) return EStateTreeRunStatus::Failed;
+	if (!AIController) return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 	
 	if (UUHLStateTreeAIComponent* Cmp = Cast<UUHLStateTreeAIComponent>(AIController->GetBrainComponent()))
 	{
 		Cmp->TagCooldowns.AddCooldownTagDuration(Context.GetOwner(), InstanceData.CooldownTag, InstanceData.Duration, InstanceData.bAddToExistingDuration);
 		if (InstanceData.bFinishTask)
 		{
-			return EStateTreeRunStatus::Succeeded;
+			return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Succeeded);
 		}
 		else
 		{
-			return EStateTreeRunStatus::Running;
+			return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Running);
 		}
 	}
 
+#if UHL_STATETREE_WITH_COSMETICS
 	GEngine->AddOnScreenDebugMessage(-1, 5, FColor::Red, TEXT("[UHLStateTreeSetCooldownTask] using UUHLStateTreeAIComponent required to use SetCooldownTask"));
-	return EStateTreeRunStatus::Failed;
+#endif
+	return UHLNodeScope.EnterStatus(Context.GetOwner(), EStateTreeRunStatus::Failed);
 }
 
 #if WITH_EDITOR
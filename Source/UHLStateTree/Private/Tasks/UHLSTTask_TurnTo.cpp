@@ -8,9 +8,11 @@
 #include "DrawDebugHelpers.h"
 #include "UHLAIBlueprintLibrary.h"
 #include "Core/UHLAIActorSettings.h"
+#include "Core/UHLFocusArbiter.h"
 #include "GameFramework/Character.h"
 #include "Engine/Engine.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Core/UHLStateTreeProfiling.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(UHLSTTask_TurnTo)
 
@@ -18,7 +20,12 @@
 
 EStateTreeRunStatus FUHLSTTask_TurnTo::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
 {
+	UHL_STATETREE_NODE_SCOPE(TurnTo);
 	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+	if (!InstanceData.FocusOwner)
+	{
+		InstanceData.FocusOwner = UHLFocus::MakeOwnerKey();
+	}
 	EStateTreeRunStatus Result = InstanceData.bInfinite
 									? EStateTreeRunStatus::Running
 									: EStateTreeRunStatus::Failed;
@@ -33,22 +40,22 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::EnterState(FStateTreeExecutionContext& Co
 	// but a valid world is required.
 	if (World == nullptr)
 	{
-		return InstanceData.bInfinite
+		return UHLNodeScope.EnterStatus(Context.GetOwner(), InstanceData.bInfinite
 				? EStateTreeRunStatus::Running
-				: EStateTreeRunStatus::Failed;
+				: EStateTreeRunStatus::Failed);
 	}
 
 	AAIController* AIController = InstanceData.AIController;
-	if (!AIController) return InstanceData.bInfinite
+	if (!AIController) return UHLNodeScope.EnterStatus(Context.GetOwner(), InstanceData.bInfinite
 						? EStateTreeRunStatus::Running
-						: EStateTreeRunStatus::Failed;
+						: EStateTreeRunStatus::Failed);
 
 	// GEngine->AddOnScreenDebugMessage(-1, 5, FColor::Red, TEXT("[UHLStateTreeTaskTurnTo] using UUHLStateTreeAIComponent required to use SetCooldownTask"));
 
 	APawn* Pawn = AIController->GetPawn();
-	if (!Pawn) return InstanceData.bInfinite
+	if (!Pawn) return UHLNodeScope.EnterStatus(Context.GetOwner(), InstanceData.bInfinite
 						? EStateTreeRunStatus::Running
-						: EStateTreeRunStatus::Failed;
+						: EStateTreeRunStatus::Failed);
 
 	const FVector PawnLocation = Pawn->GetActorLocation();
 	InstanceData.PrecisionDot = FMath::Cos(FMath::DegreesToRadians(InstanceData.Precision));
@@ -70,7 +77,7 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::EnterState(FStateTreeExecutionContext& Co
 			}
 			else
 			{
-				AIController->SetFocus(ActorValue, EAIFocusPriority::Gameplay);
+				UHLFocus::SetFocus(AIController, InstanceData.FocusOwner, ActorValue, EAIFocusPriority::Gameplay, InstanceData.RequestPriority);
 			    if (Pawn->GetClass()->ImplementsInterface(UUHLAIActorSettings::StaticClass()))
 			    {
 			        InstanceData.CurrentTurnSettings = GetTurnSettings(Context, Pawn);
@@ -95,7 +102,7 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::EnterState(FStateTreeExecutionContext& Co
 			}
 			else
 			{
-				AIController->SetFocalPoint(InstanceData.TargetLocation, EAIFocusPriority::Gameplay);
+				UHLFocus::SetFocalPoint(AIController, InstanceData.FocusOwner, InstanceData.TargetLocation, EAIFocusPriority::Gameplay, InstanceData.RequestPriority);
 				if (Pawn->GetClass()->ImplementsInterface(UUHLAIActorSettings::StaticClass()))
 				{
 					InstanceData.CurrentTurnSettings = GetTurnSettings(Context, Pawn);
@@ -128,12 +135,13 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::EnterState(FStateTreeExecutionContext& Co
 	// 	}
 	// }
 
-	return Result;
+	return UHLNodeScope.EnterStatus(Context.GetOwner(), Result);
 }
 
 EStateTreeRunStatus FUHLSTTask_TurnTo::Tick(
 	FStateTreeExecutionContext& Context, const float DeltaTime) const
 {
+	UHL_STATETREE_NODE_SCOPE(TurnTo);
 	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
 	const UWorld* World = Context.GetWorld();
@@ -146,31 +154,32 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::Tick(
 	// but a valid world is required.
 	if (World == nullptr)
 	{
-		return InstanceData.bInfinite
+		return UHLNodeScope.TickStatus(Context.GetOwner(), InstanceData.bInfinite
 				? EStateTreeRunStatus::Running
-				: EStateTreeRunStatus::Failed;
+				: EStateTreeRunStatus::Failed);
 	}
 
 	AAIController* AIController = InstanceData.AIController;
 	if (!AIController || !AIController->GetPawn())
 	{
-		return InstanceData.bInfinite
+		return UHLNodeScope.TickStatus(Context.GetOwner(), InstanceData.bInfinite
 				? EStateTreeRunStatus::Running
-				: EStateTreeRunStatus::Failed;
+				: EStateTreeRunStatus::Failed);
 	}
 
-	// target enemy if its infinite task
-	if (InstanceData.bInfinite
-		&& InstanceData.TargetActor
-		&& AIController->GetFocusActorForPriority(EAIFocusPriority::Gameplay) != InstanceData.TargetActor)
+	// target enemy if its infinite task, resubmitting the same target is free
+	if (InstanceData.bInfinite && InstanceData.TargetActor)
 	{
-		AIController->SetFocus(InstanceData.TargetActor, EAIFocusPriority::Gameplay);
+		UHLFocus::SetFocus(AIController, InstanceData.FocusOwner, InstanceData.TargetActor, EAIFocusPriority::Gameplay, InstanceData.RequestPriority);
 	}
 	const FVector PawnDirection = AIController->GetPawn()->GetActorForwardVector();
-   	const FVector FocalPoint = AIController->GetFocalPointForPriority(EAIFocusPriority::Gameplay);
+	// the arbiter applies focus after the tree tick, so the controller may not have the requested point yet
+	const FVector FocalPoint = InstanceData.TargetActor
+		? InstanceData.TargetActor->GetActorLocation()
+		: InstanceData.TargetLocation;
     ACharacter* AICharacter = AIController->GetCharacter();
 
-	if (FocalPoint != FAISystem::InvalidLocation)
+	if (FAISystem::IsValidLocation(FocalPoint))
 	{
 	    float DeltaAngleRad = TurnToStatics::CalculateAngleDifferenceDot(PawnDirection, FocalPoint - AIController->GetPawn()->GetActorLocation());
 	    // float DeltaAngle = FMath::RadiansToDegrees(FMath::Acos(DeltaAngleRad));
@@ -178,6 +187,7 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::Tick(
 			? UUHLAIBlueprintLibrary::RelativeAngleToActor(AICharacter, InstanceData.TargetActor)
 			: UUHLAIBlueprintLibrary::RelativeAngleToVector(AICharacter, InstanceData.TargetLocation);
 
+#if UHL_STATETREE_WITH_COSMETICS
 		if (InstanceData.bDebug)
 		{
 			FString Message = FString::Printf(TEXT("DeltaAngle %f"), DeltaAngle);
@@ -188,13 +198,16 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::Tick(
 			DrawDebugSphere(AIController->GetWorld(), CurrentLocation,
 				50.0f, 12, FColor::Blue, false, -1);
 		}
+#endif
 
 		if (DeltaAngleRad >= InstanceData.PrecisionDot)
 		{
+#if UHL_STATETREE_WITH_COSMETICS
 			if (InstanceData.bDebug && GEngine)
 			{
 				GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Cyan, FString::Printf(TEXT("TurnRange->bOverrideStopMontageOnGoalReached %hhd"), InstanceData.CurrentTurnRange.bOverrideStopMontageOnGoalReached));
 			}
+#endif
 		    bool bCanStopMontage = false;
 		    if (InstanceData.CurrentTurnRange.bOverrideStopMontageOnGoalReached)
 		    {
@@ -208,19 +221,19 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::Tick(
 		    if (bCanStopMontage)
 		    {
 		        AICharacter->StopAnimMontage();
-			    AIController->ClearFocus(EAIFocusPriority::Gameplay);
+			    UHLFocus::ReleaseFocus(AIController, InstanceData.FocusOwner, EAIFocusPriority::Gameplay);
 		        // CleanUp(*AIController, NodeMemory);
-			    return InstanceData.bInfinite
+			    return UHLNodeScope.TickStatus(Context.GetOwner(), InstanceData.bInfinite
 			    	? EStateTreeRunStatus::Running
-			    	: EStateTreeRunStatus::Succeeded;
+			    	: EStateTreeRunStatus::Succeeded);
 		    }
 		    else
 		    {
-			    AIController->ClearFocus(EAIFocusPriority::Gameplay);
+			    UHLFocus::ReleaseFocus(AIController, InstanceData.FocusOwner, EAIFocusPriority::Gameplay);
 		        // CleanUp(*AIController, NodeMemory);
-			    return InstanceData.bInfinite
+			    return UHLNodeScope.TickStatus(Context.GetOwner(), InstanceData.bInfinite
 					? EStateTreeRunStatus::Running
-					: EStateTreeRunStatus::Succeeded;
+					: EStateTreeRunStatus::Succeeded);
 		    }
 		}
 	    else
@@ -243,25 +256,35 @@ EStateTreeRunStatus FUHLSTTask_TurnTo::Tick(
 	            // finish if no turn animation found and "bTurnOnlyWithAnims"
 	            if (!bCurrentTurnRangeSet && InstanceData.CurrentTurnSettings.bTurnOnlyWithAnims)
 	            {
-		            AIController->ClearFocus(EAIFocusPriority::Gameplay);
+		            UHLFocus::ReleaseFocus(AIController, InstanceData.FocusOwner, EAIFocusPriority::Gameplay);
 	                // CleanUp(*AIController, NodeMemory);
-		            return InstanceData.bInfinite
+		            return UHLNodeScope.TickStatus(Context.GetOwner(), InstanceData.bInfinite
 						? EStateTreeRunStatus::Running
-						: EStateTreeRunStatus::Succeeded;
+						: EStateTreeRunStatus::Succeeded);
 	            }
 	        }
 	    }
 	}
 	else
 	{
-		AIController->ClearFocus(EAIFocusPriority::Gameplay);
+		UHLFocus::ReleaseFocus(AIController, InstanceData.FocusOwner, EAIFocusPriority::Gameplay);
 		// CleanUp(*AIController, NodeMemory);
-		return InstanceData.bInfinite
+		return UHLNodeScope.TickStatus(Context.GetOwner(), InstanceData.bInfinite
 					? EStateTreeRunStatus::Running
-					: EStateTreeRunStatus::Failed;
+					: EStateTreeRunStatus::Failed);
 	}
 
-	return FStateTreeTaskCommonBase::Tick(Context, DeltaTime);
+	return UHLNodeScope.TickStatus(Context.GetOwner(), FStateTreeTaskCommonBase::Tick(Context, DeltaTime));
+}
+
+void FUHLSTTask_TurnTo::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	UHL_STATETREE_NODE_SCOPE(TurnTo);
+	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+	if (FUHLFocusArbiter* Arbiter = UHLFocus::FindArbiter(InstanceData.AIController))
+	{
+		Arbiter->ReleaseRequest(InstanceData.FocusOwner, EAIFocusPriority::Gameplay);
+	}
 }
 
 #if WITH_EDITOR
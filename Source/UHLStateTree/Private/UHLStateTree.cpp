@@ -2,19 +2,50 @@
 
 #include "UHLStateTree.h"
 
+#include "Misc/CoreDelegates.h"
 #include "Misc/Paths.h"
+#include "Conditions/StateTreeCommonConditions.h"
+#include "Conditions/UHLSTCondition_InAngle.h"
+#include "Conditions/UHLSTCondition_InRange.h"
+#include "Conditions/UHLSTCondition_TagCooldown.h"
+#include "Core/UHLStateTreeParallel.h"
+#include "Core/UHLStateTreeTelemetry.h"
+#include "Tasks/StateTreeDelayTask.h"
+#include "Tasks/UHLSTTask_ClearFocus.h"
+#include "Tasks/UHLSTTask_GameplayFocus.h"
+#include "Tasks/UHLSTTask_SetCooldown.h"
 
 #define LOCTEXT_NAMESPACE "FUHLStateTreeModule"
 
+DEFINE_LOG_CATEGORY(LogUHLStateTree);
+
 
 void FUHLStateTreeModule::StartupModule()
 {
+	// nodes that only read world state and write their own agent, focus goes through the component's arbiter
+	UHLStateTreeParallel::RegisterThreadSafeNode(FUHLSTCondition_InRange::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FUHLSTCondition_InAngle::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FUHLSTCondition_TagCooldown::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FUHLSTTask_SetCooldown::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FUHLSTTask_GameplayFocus::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FUHLSTTask_ClearFocus::StaticStruct());
+
+	// pure engine nodes commonly found next to them
+	UHLStateTreeParallel::RegisterThreadSafeNode(FStateTreeCompareIntCondition::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FStateTreeCompareFloatCondition::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FStateTreeCompareBoolCondition::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FStateTreeCompareEnumCondition::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FStateTreeObjectIsValidCondition::StaticStruct());
+	UHLStateTreeParallel::RegisterThreadSafeNode(FStateTreeDelayTask::StaticStruct());
+
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&UHLStateTreeTelemetry::EndFrame);
 }
 
 void FUHLStateTreeModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
 }
 
 #undef LOCTEXT_NAMESPACE
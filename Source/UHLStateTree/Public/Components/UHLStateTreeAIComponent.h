@@ -6,10 +6,21 @@
 #include "StateTreeReference.h"
 #include "Components/StateTreeAIComponent.h"
 #include "Core/UHLTagCooldowns.h"
+#include "Core/UHLFocusArbiter.h"
+#include "Subsystems/UHLStateTreeSubsystem.h"
+#include "Core/UHLStateTreeSignificance.h"
+#include "Core/UHLStateTreeParallel.h"
+#include "Core/UHLStateTreeSnapshot.h"
+#include "Core/UHLStateTreeAssetUtils.h"
 #include "Misc/EngineVersion.h" 
 #include "Misc/EngineVersionComparison.h"
 #include "UHLStateTreeAIComponent.generated.h"
 
+struct FStreamableHandle;
+class AAIController;
+class APawn;
+class UUHLMontageReplicatorObject;
+
 /**
  * 
  */
@@ -20,13 +31,243 @@ class UHLSTATETREE_API UUHLStateTreeAIComponent : public UStateTreeAIComponent
 
 
 public:
+	/** Returns the UHL StateTree component that is the brain of Controller, if any. */
+	static UUHLStateTreeAIComponent* FindForController(const AAIController* Controller);
+
 	/** Swap in *any* FStateTreeReference at runtime */
 	void SetStateTreeReference(const FStateTreeReference& NewRef, const FStateTreeReferenceOverrides& NewOverrides);
 
+	/**
+	 * Streams NewStateTree and its linked overrides in the background and swaps them in at the next tick boundary,
+	 * so phase changes don't hitch on a synchronous load. Replaces a pending swap.
+	 * If NewStateTree is the running tree, only the linked overrides change and the run continues: active linked
+	 * subtrees keep running, new overrides are used the next time their linked state is entered.
+	 * Otherwise the tree restarts on the new asset: active states exit and global task and evaluator state is lost.
+	 * With bCarryOverParameters, parameter values with matching name and type are kept on restart.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree", meta = (AutoCreateRefTerm = "NewLinkedOverrides"))
+	void SwapStateTreeAsync(TSoftObjectPtr<UStateTree> NewStateTree, const TMap<FGameplayTag, TSoftObjectPtr<UStateTree>>& NewLinkedOverrides, bool bCarryOverParameters = true);
+
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	bool HasPendingStateTreeSwap() const;
+
+	/** Swap assets are loaded and wait for ApplyPendingStateTreeSwap */
+	bool IsStateTreeSwapReady() const { return bSwapReady; }
+
+	/** Swaps in the loaded tree, called at tick boundaries on the game thread. */
+	void ApplyPendingStateTreeSwap();
+
+	/** Saves the current run of the tree, see FUHLStateTreeSnapshot. */
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	bool SaveSnapshot(FUHLStateTreeSnapshot& OutSnapshot);
+
+	/**
+	 * Continues the run saved in Snapshot without entering its states again, a running tree is stopped first.
+	 * Invalid snapshots leave the current run untouched.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	bool RestoreSnapshot(const FUHLStateTreeSnapshot& Snapshot);
+
+	virtual void StartLogic() override;
+	virtual void StopLogic(const FString& Reason) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 6)
+	/** UStateTreeComponent schedules its own tick from the tree, agents ticked by UUHLStateTreeSubsystem keep it off */
+	virtual void SetComponentTickEnabled(bool bEnabled) override;
+#endif
+
 #if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION == 5
 	virtual bool SetContextRequirements(FStateTreeExecutionContext& Context, bool bLogErrors = false) override;
 #endif
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FUHLTagCooldowns TagCooldowns = {};
+
+	/** Class the agent is ticked in when UUHLStateTreeSubsystem schedules ticks, see uhl.StateTree.TickBudgetMs */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Tick")
+	EUHLStateTreeTickPriority TickPriority = EUHLStateTreeTickPriority::Normal;
+
+	/**
+	 * Tree ticks on task graph workers together with other agents if all its nodes are registered thread-safe,
+	 * see UHLStateTreeParallel. Game thread work of nodes is deferred and applied after the parallel phase.
+	 * Blueprint tick of the component isn't called in this mode. Otherwise the tree ticks on the game thread as usual.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Tick")
+	bool bAllowParallelTick = false;
+
+	/**
+	 * Tick is disabled while no active node needs it, e.g. all tasks wait for montage end.
+	 * Woken up by StateTree events, RequestImmediateTick, SetStateTreeReference and at least every uhl.StateTree.MaxSleepSeconds.
+	 * UE 5.5: sleeps while no active task, global task or evaluator ticks and no active transition is checked on tick or delayed.
+	 * Active non UHL tasks keep it awake, they can finish from callbacks that don't wake it up.
+	 * UE 5.6+: follows the tree's scheduled tick and also wakes up for it. Agents ticking themselves are already put
+	 * to sleep by UStateTreeComponent there, so this only affects agents ticked by UUHLStateTreeSubsystem.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Tick")
+	bool bAllowSleep = false;
+
+	UFUNCTION(BlueprintCallable, Category = "Tick")
+	bool IsSleeping() const { return bSleeping; }
+
+	/** Polled by UUHLStateTreeSubsystem while sleeping. */
+	bool ShouldWakeUp(double Now) const;
+	void WakeUp();
+
+	/** Ticks the tree on a worker thread, called by UUHLStateTreeSubsystem. */
+	void TickParallel(float DeltaTime);
+	/** Applies deferred work of TickParallel on the game thread. */
+	void FinishParallelTick();
+
+	/**
+	 * Rates the agent's significance and lowers its tick rate when it's far, off-screen or out of combat.
+	 * Evaluated by UUHLStateTreeSubsystem every uhl.StateTree.SignificanceUpdateInterval. Not set ticks every frame.
+	 */
+	UPROPERTY(EditAnywhere, Instanced, BlueprintReadOnly, Category = "Tick")
+	TObjectPtr<UUHLStateTreeSignificanceEvaluator> SignificanceEvaluator = nullptr;
+
+	void UpdateSignificance(const TArray<FVector>& ViewLocations, double Now);
+
+	UFUNCTION(BlueprintCallable, Category = "Tick")
+	float GetSignificance() const { return Significance; }
+
+	UFUNCTION(BlueprintCallable, Category = "Tick")
+	EUHLStateTreeTickRate GetTickRate() const { return TickRate; }
+
+	/** Seconds between tree ticks at the current rate, 0 for every frame */
+	float GetTickRateInterval() const;
+
+	/**
+	 * Ticks the tree on the next frame regardless of its tick rate. Used by callbacks that finish tasks or send events,
+	 * e.g. montage end, so reduced rates don't delay transitions.
+	 */
+	void RequestImmediateTick();
+	bool HasImmediateTickRequest() const { return bImmediateTickRequested; }
+
+	/**
+	 * Instance data is taken from UUHLStateTreeInstancePoolSubsystem on first start and returned on end play,
+	 * so frequently spawned agents reuse instance buffers of despawned ones.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pooling")
+	bool bUseInstanceDataPool = false;
+
+	const UStateTree* GetStateTreeAsset() const { return StateTreeRef.GetStateTree(); }
+
+	/** Instance data of the current run, used by memory reports */
+	const FStateTreeInstanceData& GetTreeInstanceData() const { return InstanceData; }
+
+	/** Focus requests of UHL nodes, applied to the AIController after the tree ticks */
+	FUHLFocusArbiter& GetFocusArbiter() { return FocusArbiter; }
+
+	/** Montage replicator of Actor, cached so montage plays don't search the actor's subobjects. Authority only. */
+	UUHLMontageReplicatorObject* GetMontageReplicator(AActor* Actor);
+
+	/**
+	 * Control rotation from focus is updated by UUHLFocusRotationSubsystem in one batch with other agents
+	 * while logic runs, before the pawn's movement. Requires the owner to be an AUHLStateTreeAIController,
+	 * which skips only its own UpdateControlRotation meanwhile.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Focus")
+	bool bUseBatchedFocusRotation = false;
+
+	/** Degrees per second control rotation turns to focus with when batched, 0 snaps */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Focus", meta = (EditCondition = "bUseBatchedFocusRotation", ClampMin = "0.0"))
+	float FocusRotationInterpSpeed = 0.0f;
+
+private:
+	/** Registration after the tree started running, shared by StartLogic and RestoreSnapshot */
+	void OnLogicStarted();
+
+	/** Registers montages the tree can play in the pawn's montage replicator, so plays are sent as table indices */
+	void PrebuildMontageTable();
+
+	void RegisterTickScheduling();
+	void UnregisterTickScheduling();
+
+	void RegisterFocusRotation();
+	void UnregisterFocusRotation();
+
+	void SetTickRate(EUHLStateTreeTickRate NewRate);
+
+	/** Game thread work after every tree tick */
+	void PostTreeTick();
+
+	/** Puts the component to sleep if the tree doesn't need ticking for a while */
+	void TrySleep();
+
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION == 5
+	/** No scheduled tick info before 5.6, true if an active task, global task, evaluator or transition needs ticks */
+	bool HasTickingActiveNodes();
+
+	/** Builds sleep info of the tree and its linked overrides, linked trees without an override are built on first use */
+	void PrebuildSleepInfo();
+	const UHLStateTreeAssetUtils::FSleepInfo& FindOrAddSleepInfo(const UStateTree* StateTree);
+
+	/** One entry per tree that can run, dropped with the context cache */
+	TArray<UHLStateTreeAssetUtils::FSleepInfo> SleepInfos;
+#endif
+
+	/** Streams in soft montages of the current tree and its linked overrides, replacing the previous preload */
+	void RequestMontagePreload();
+	void ReleaseMontagePreload();
+
+	void CancelPendingStateTreeSwap();
+
+	TSharedPtr<FStreamableHandle> SwapLoadHandle;
+	TSoftObjectPtr<UStateTree> PendingSwapStateTree;
+	TMap<FGameplayTag, TSoftObjectPtr<UStateTree>> PendingSwapOverrides;
+	bool bPendingSwapCarryOverParameters = false;
+	bool bSwapReady = false;
+
+	/** Drops external data resolved for execution contexts, they're resolved again on the next tick */
+	void InvalidateContextCache();
+
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION == 5
+	/** Resolves external data of StateTree once and reuses it for every following execution context */
+	bool CollectExternalDataCached(const FStateTreeExecutionContext& Context, const UStateTree* StateTree, TArrayView<const FStateTreeExternalDataDesc> ExternalDataDescs, TArrayView<FStateTreeDataView> OutDataViews) const;
+
+	struct FExternalDataCacheEntry
+	{
+		const UStateTree* StateTree = nullptr;
+		TArray<FStateTreeDataView> DataViews;
+		/** Objects behind DataViews, a destroyed one invalidates the entry */
+		TArray<TWeakObjectPtr<const UObject>> Objects;
+	};
+
+	/** One entry for the tree and each linked tree that ran, written by the tick that owns the component only */
+	mutable TArray<FExternalDataCacheEntry> ExternalDataCache;
+	/** External data lives on the pawn, a new one invalidates the cache */
+	mutable TWeakObjectPtr<const APawn> ExternalDataPawn;
+#endif
+
+	/** Keeps preloaded montages resident while this tree is live */
+	TSharedPtr<FStreamableHandle> MontagePreloadHandle;
+
+	FUHLFocusArbiter FocusArbiter;
+
+	/** Replicator of the pawn, goes stale when the pawn ends play or the controller possesses another one */
+	TWeakObjectPtr<UUHLMontageReplicatorObject> MontageReplicator;
+
+	float Significance = 1.0f;
+	EUHLStateTreeTickRate TickRate = EUHLStateTreeTickRate::EveryFrame;
+	/** Time significance first fell below the current rate, -1 if it didn't */
+	double DemotionStartTime = -1.0;
+	bool bImmediateTickRequested = false;
+	/** Ticked by UUHLStateTreeSubsystem instead of own tick function */
+	bool bTickScheduled = false;
+
+	FUHLStateTreeCommandBuffer ParallelCommands;
+
+	/** Pool was asked for instance data already, later starts reuse our own */
+	bool bInstanceDataAcquired = false;
+
+	bool bSleeping = false;
+	/** Own tick function doesn't count time it was disabled, first tick after sleep passes the full delta */
+	bool bCatchUpDeltaTime = false;
+	double WakeUpTime = 0.0;
+	double LastTreeTickTime = 0.0;
+
+	/** Counted in UHLStateTreeTelemetry active agents */
+	bool bCountedActive = false;
 };
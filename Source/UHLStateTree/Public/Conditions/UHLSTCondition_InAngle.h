@@ -61,6 +61,9 @@ struct UHLSTATETREE_API FUHLSTCondition_InAngle : public FStateTreeConditionComm
 	virtual const UStruct* GetInstanceDataType() const override { return FUHLSTCondition_InAngleInstanceData::StaticStruct(); }
 	virtual bool TestCondition(FStateTreeExecutionContext& Context) const override;
 
+	/** Condition without the execution context, used by TestCondition and microbenchmarks. */
+	static bool Evaluate(const FInstanceDataType& InstanceData);
+
 #if WITH_EDITOR
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
 	virtual FName GetIconName() const override
@@ -5,6 +5,8 @@
 #include "StateTreeConditionBase.h"
 #include "UHLSTCondition_TagCooldown.generated.h"
 
+class AAIController;
+
 USTRUCT()
 struct UHLSTATETREE_API FUHLSTCondition_TagCooldownInstanceData
 {
@@ -31,6 +33,10 @@ struct UHLSTATETREE_API FUHLSTCondition_TagCooldown : public FStateTreeCondition
 	
 	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
 	virtual bool TestCondition(FStateTreeExecutionContext& Context) const override;
+
+	/** Condition without the execution context, AIController is the context owner. Used by TestCondition and microbenchmarks. */
+	static bool Evaluate(const FInstanceDataType& InstanceData, const AAIController* AIController);
+
 #if WITH_EDITOR
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
 	virtual FName GetIconName() const override
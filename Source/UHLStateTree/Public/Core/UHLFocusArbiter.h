@@ -0,0 +1,91 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AITypes.h"
+
+class AAIController;
+class AActor;
+
+/** Focus one node wants on one AIController focus slot. No actor and an invalid location means the slot is cleared. */
+struct UHLSTATETREE_API FUHLFocusRequest
+{
+	TWeakObjectPtr<AActor> Actor;
+
+	FVector Location = FAISystem::InvalidLocation;
+
+	/** Higher wins, on equal priority the most recently changed request wins. */
+	int32 Priority = 0;
+
+	bool IsClear() const { return !Actor.IsValid() && !FAISystem::IsValidLocation(Location); }
+	bool IsSameTarget(const FUHLFocusRequest& Other) const;
+};
+
+/**
+ * Arbitrates focus requests of StateTree nodes, so parallel states don't fight over the same AIController focus slot.
+ * Requests are resolved at most once per frame and the controller is written only when the resolved target changes.
+ */
+class UHLSTATETREE_API FUHLFocusArbiter
+{
+public:
+	/** Adds or updates the request of Owner, a node instance key from UHLFocus::MakeOwnerKey. Resubmitting the same target is free. */
+	void SubmitRequest(const void* Owner, uint8 FocusSlot, const FUHLFocusRequest& Request);
+	void ReleaseRequest(const void* Owner, uint8 FocusSlot);
+
+	/** Drops requests of the slot up to MaxPriority and clears the slot on the controller, like a one-shot ClearFocus. */
+	void ClearRequests(uint8 FocusSlot, int32 MaxPriority);
+
+	bool HasPendingChanges() const { return bAnyDirty; }
+
+	/** Writes slots whose resolved target changed since the last resolve. */
+	void Resolve(AAIController* Controller);
+
+	/** Drops all requests and clears slots written by this arbiter. */
+	void Reset(AAIController* Controller);
+
+private:
+	struct FOwnedRequest
+	{
+		const void* Owner = nullptr;
+		FUHLFocusRequest Request;
+		uint32 Serial = 0;
+	};
+
+	struct FSlot
+	{
+		TArray<FOwnedRequest, TInlineAllocator<2>> Requests;
+		/** Last target written to the controller, unset if the slot isn't driven by the arbiter */
+		TOptional<FUHLFocusRequest> Applied;
+		bool bDirty = false;
+		bool bForceClear = false;
+	};
+
+	FSlot& GetSlot(uint8 FocusSlot);
+	void MarkDirty(FSlot& Slot);
+
+	TArray<FSlot, TInlineAllocator<EAIFocusPriority::Gameplay + 1>> Slots;
+	uint32 NextSerial = 0;
+	bool bAnyDirty = false;
+};
+
+/**
+ * Focus writes of UHL nodes. They go through the arbiter of UUHLStateTreeAIComponent when it's the controller's brain,
+ * otherwise write the controller directly, skipping writes that wouldn't change its focus.
+ */
+namespace UHLFocus
+{
+	UHLSTATETREE_API FUHLFocusArbiter* FindArbiter(const AAIController* Controller);
+
+	/**
+	 * New owner key for one node instance. The node is shared by instances of linked subtrees
+	 * and instance data moves when frames are added, so nodes keep the key in their instance data.
+	 */
+	UHLSTATETREE_API const void* MakeOwnerKey();
+
+	UHLSTATETREE_API void SetFocus(AAIController* Controller, const void* Owner, AActor* Actor, uint8 FocusSlot, int32 Priority = 0);
+	UHLSTATETREE_API void SetFocalPoint(AAIController* Controller, const void* Owner, const FVector& Location, uint8 FocusSlot, int32 Priority = 0);
+
+	/** Withdraws focus of Owner. Without an arbiter the slot is cleared. */
+	UHLSTATETREE_API void ReleaseFocus(AAIController* Controller, const void* Owner, uint8 FocusSlot);
+}
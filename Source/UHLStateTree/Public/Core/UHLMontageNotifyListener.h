@@ -0,0 +1,55 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstance.h"
+#include "GameplayTagContainer.h"
+#include "StateTreeAsyncExecutionContext.h"
+#include "UObject/Object.h"
+#include "UHLMontageNotifyListener.generated.h"
+
+/** Maps a montage notify to StateTree events. */
+USTRUCT()
+struct UHLSTATETREE_API FUHLSTMontageNotifyEvent
+{
+	GENERATED_BODY()
+
+	/** Name of a "Montage Notify" or "Montage Notify Window" placed in the montage */
+	UPROPERTY(EditAnywhere, Category = "Parameter")
+	FName NotifyName = NAME_None;
+
+	/** Sent when the notify fires or the notify window begins */
+	UPROPERTY(EditAnywhere, Category = "Parameter")
+	FGameplayTag BeginEventTag;
+
+	/** Sent when the notify window ends */
+	UPROPERTY(EditAnywhere, Category = "Parameter")
+	FGameplayTag EndEventTag;
+};
+
+/**
+ * Forwards montage notifies of a single montage instance to a StateTree as events.
+ * Only notifies of the bound montage instance are forwarded, other montages on the same AnimInstance are ignored.
+ */
+UCLASS()
+class UHLSTATETREE_API UUHLMontageNotifyListener : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	void Bind(UAnimInstance* InAnimInstance, int32 InMontageInstanceID, TConstArrayView<FUHLSTMontageNotifyEvent> InEvents, const FStateTreeWeakExecutionContext& InWeakContext);
+	void Unbind();
+
+private:
+	UFUNCTION()
+	void OnNotifyBegin(FName NotifyName, const FBranchingPointNotifyPayload& BranchingPointPayload);
+
+	UFUNCTION()
+	void OnNotifyEnd(FName NotifyName, const FBranchingPointNotifyPayload& BranchingPointPayload);
+
+	TWeakObjectPtr<UAnimInstance> AnimInstance;
+	int32 MontageInstanceID = INDEX_NONE;
+	TArray<FUHLSTMontageNotifyEvent> Events;
+	FStateTreeWeakExecutionContext WeakContext;
+};
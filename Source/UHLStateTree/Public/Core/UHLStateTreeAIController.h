@@ -0,0 +1,28 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "UHLStateTreeAIController.generated.h"
+
+/**
+ * AI controller whose control rotation can be updated by UUHLFocusRotationSubsystem in a batch with other agents.
+ * Only UpdateControlRotation is skipped while batched, the actor tick runs as usual.
+ * Required for UUHLStateTreeAIComponent::bUseBatchedFocusRotation.
+ */
+UCLASS()
+class UHLSTATETREE_API AUHLStateTreeAIController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	virtual void UpdateControlRotation(float DeltaTime, bool bUpdatePawn = true) override;
+
+	/** Set by UUHLFocusRotationSubsystem on register and unregister */
+	void SetBatchedFocusRotation(bool bInBatched) { bBatchedFocusRotation = bInBatched; }
+	bool IsFocusRotationBatched() const { return bBatchedFocusRotation; }
+
+private:
+	bool bBatchedFocusRotation = false;
+};
@@ -0,0 +1,36 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimMontage;
+class UStateTree;
+
+namespace UHLStateTreeAssetUtils
+{
+	/** Which parts of a tree keep an agent awake, see UUHLStateTreeAIComponent::bAllowSleep */
+	struct FSleepInfo
+	{
+		const UStateTree* StateTree = nullptr;
+		/** An evaluator or a global task needs ticks */
+		bool bGlobalNeedsTick = false;
+		/** Per state, one of its tasks needs ticks or one of its transitions is checked on tick or delayed */
+		TBitArray<> StatesNeedingTick;
+	};
+
+	/**
+	 * Tasks need ticks if they tick, or if they aren't UHL tasks: other tasks may finish through
+	 * FStateTreeWeakExecutionContext without waking the agent, UHL ones request an immediate tick.
+	 */
+	UHLSTATETREE_API void BuildSleepInfo(const UStateTree* StateTree, FSleepInfo& OutInfo);
+
+	/**
+	 * Collects montages set on UHL nodes in the default instance data of StateTree, including soft montages that are already loaded.
+	 * Bound values are not known up front and are skipped.
+	 */
+	UHLSTATETREE_API void CollectMontages(const UStateTree* StateTree, TArray<UAnimMontage*>& OutMontages);
+
+	/** Collects soft montage paths set on UHL nodes in the default instance data of StateTree, loaded or not. */
+	UHLSTATETREE_API void CollectSoftMontages(const UStateTree* StateTree, TArray<FSoftObjectPath>& OutPaths);
+}
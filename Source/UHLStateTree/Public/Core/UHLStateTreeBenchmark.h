@@ -0,0 +1,102 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "UObject/Object.h"
+#include "UHLStateTreeBenchmark.generated.h"
+
+class APawn;
+class FJsonObject;
+class FJsonValue;
+
+/**
+ * Spawns N AI pawns running their UHL StateTree, measures frame time, time per UHL node and memory over a number of frames
+ * and writes the results as JSON to Saved/Profiling/UHLStateTree, optionally comparing them with a baseline file.
+ * Started with uhl.StateTree.Benchmark, works headless, e.g. UnrealServer -ExecCmds="uhl.StateTree.Benchmark Pawn=... -Quit".
+ * Pawn's AI controller is expected to use UUHLStateTreeAIComponent with a tree representative of the game.
+ *
+ * Long runs (e.g. Frames=108000) double as a soak test, montage replicators of the agents must not grow after warmup.
+ * On a server with connected clients the net flush time per connection is recorded too. Running once with
+ * -UseIrisReplication=0 and once with -UseIrisReplication=1, the second with Baseline= set to the first results,
+ * compares server CPU per connection of legacy replication and Iris.
+ */
+UCLASS()
+class UHLSTATETREE_API UUHLStateTreeBenchmark : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	struct FSettings
+	{
+		TSoftClassPtr<APawn> PawnClass;
+		/** One run per count, agents are respawned between runs */
+		TArray<int32> AgentCounts = { 100, 1000, 5000 };
+		int32 WarmupFrames = 60;
+		int32 Frames = 600;
+		float Spacing = 300.0f;
+		FString OutputName;
+		FString BaselinePath;
+		/** Percent a metric may grow over the baseline before it's reported as a regression */
+		float RegressionPercent = 10.0f;
+		bool bQuitWhenDone = false;
+	};
+
+	/** Returns nullptr if a benchmark is already running or the pawn class can't be loaded. */
+	static UUHLStateTreeBenchmark* Start(UWorld* World, const FSettings& InSettings);
+
+private:
+	bool Tick(float DeltaTime);
+
+	/** Net drivers flush between post actor tick and the end of the world tick */
+	void OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnWorldTickEnd(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+	void BeginRun();
+	void FinishRun();
+	void Finish();
+
+	void SpawnAgents(int32 Count);
+	void DestroyAgents();
+
+	/** Live UUHLMontageReplicatorObjects of the agents, one per pawn at most */
+	int32 CountMontageReplicators() const;
+
+	/** Returns number of regressions against the baseline */
+	int32 CompareWithBaseline(const TSharedRef<FJsonObject>& Results) const;
+
+	FSettings Settings;
+	TWeakObjectPtr<UWorld> World;
+	TSubclassOf<APawn> PawnClass;
+	FTSTicker::FDelegateHandle TickerHandle;
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle TickEndHandle;
+
+	UPROPERTY()
+	TArray<TObjectPtr<APawn>> Agents;
+
+	int32 RunIndex = 0;
+	int32 RunFrame = 0;
+	uint64 UsedMemoryBeforeSpawn = 0;
+	uint64 UsedMemoryAfterWarmup = 0;
+
+	double FrameMsSum = 0.0;
+	double FrameMsMax = 0.0;
+	double GameThreadMsSum = 0.0;
+	double SchedulerMsSum = 0.0;
+	double NetFlushMsSum = 0.0;
+	int64 ConnectionsSum = 0;
+
+	uint64 NetFlushStartCycles = 0;
+	/** Net flush time of the last world tick */
+	double LastNetFlushMs = 0.0;
+
+	int32 ReplicatorsAfterWarmup = 0;
+	/** Runs whose montage replicators grew after warmup */
+	int32 SoakFailures = 0;
+
+	TArray<TSharedPtr<FJsonValue>> RunResults;
+
+	static TWeakObjectPtr<UUHLStateTreeBenchmark> Running;
+};
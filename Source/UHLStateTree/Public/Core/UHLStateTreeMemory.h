@@ -0,0 +1,27 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+/** Allocations of the plugin, shown under UHLStateTree in stat LLM and memreport -llm when running with -llm. */
+LLM_DECLARE_TAG_API(UHLStateTree, UHLSTATETREE_API);
+/** StateTree instance data of UHL components, including the instance data pool */
+LLM_DECLARE_TAG_API(UHLStateTree_InstanceData, UHLSTATETREE_API);
+/** FUHLTagCooldowns maps */
+LLM_DECLARE_TAG_API(UHLStateTree_Cooldowns, UHLSTATETREE_API);
+/** Montage replicators, their tables and batched operations */
+LLM_DECLARE_TAG_API(UHLStateTree_Net, UHLSTATETREE_API);
+/** Patrolling path waypoints */
+LLM_DECLARE_TAG_API(UHLStateTree_Navigation, UHLSTATETREE_API);
+
+/**
+ * Footprint of UHL nodes. uhl.StateTree.MemReport logs instance data sizes per StateTree asset and UHL node type
+ * for running agents of the world.
+ */
+namespace UHLStateTreeMemory
+{
+	/** Heap bytes held by string and array properties of Struct, elements of arrays aren't followed. */
+	UHLSTATETREE_API SIZE_T GetAllocatedSize(const UStruct* Struct, const void* Data);
+}
@@ -0,0 +1,19 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+/**
+ * Isolated throughput of UHL node logic. Builds a minimal game world with two characters and an AI controller,
+ * runs each node's logic with fixed inputs Iterations times and reports nanoseconds and allocations per call.
+ * Focus tasks are covered by their focus writes through FUHLFocusArbiter, rows are named after the calls measured.
+ * Started with uhl.StateTree.MicroBench, works headless. Results go to Saved/Profiling/UHLStateTree as JSON.
+ */
+namespace UHLStateTreeMicroBench
+{
+	/** bQuitWhenDone exits the process afterwards, for automated headless runs. */
+	UHLSTATETREE_API void Run(int32 Iterations, const FString& OutputName, bool bQuitWhenDone = false);
+}
+#endif
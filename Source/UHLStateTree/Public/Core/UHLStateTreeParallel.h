@@ -0,0 +1,58 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UStateTree;
+class UScriptStruct;
+struct FStateTreeReferenceOverrides;
+
+/** Game thread work produced by a tree ticking on a worker, executed in order after the parallel tick. */
+struct UHLSTATETREE_API FUHLStateTreeCommandBuffer
+{
+	void Add(TUniqueFunction<void()>&& Command) { Commands.Add(MoveTemp(Command)); }
+	bool IsEmpty() const { return Commands.IsEmpty(); }
+	void Execute();
+
+private:
+	TArray<TUniqueFunction<void()>> Commands;
+};
+
+/**
+ * Parallel StateTree ticking of UUHLStateTreeAIComponent. A tree may tick on a task graph worker only if all its nodes,
+ * including property functions and linked trees, are registered thread-safe: they read world state that doesn't change
+ * during the parallel phase and touch only their own agent, or defer game thread work with RunOnGameThread.
+ *
+ * The whole FStateTreeExecutionContext runs on the worker, registering a node also vouches for what it's bound to:
+ * - property bindings are copied on the worker, sources may be instance data and parameters of the tree or properties
+ *   of the agent's own context objects, never state other agents or game thread systems write during the phase;
+ * - external data the node requires is resolved on the worker, it must be safe to look up from there,
+ *   e.g. the pawn's components or world subsystems that already exist.
+ * Only node types are checked by IsTreeThreadSafe. Game thread only UHL entry points checkSlow that they aren't reached
+ * from a parallel tick.
+ */
+namespace UHLStateTreeParallel
+{
+	UHLSTATETREE_API void RegisterThreadSafeNode(const UScriptStruct* NodeStruct);
+	UHLSTATETREE_API bool IsNodeThreadSafe(const UScriptStruct* NodeStruct);
+
+	/** True if StateTree, its linked assets and Overrides only use thread-safe nodes. */
+	UHLSTATETREE_API bool IsTreeThreadSafe(const UStateTree* StateTree, const FStateTreeReferenceOverrides* Overrides = nullptr);
+
+	/** True while this thread ticks a tree in parallel mode. */
+	UHLSTATETREE_API bool IsInParallelTick();
+
+	/** Runs Command right away on the game thread, or defers it to the command buffer of the tree ticking on this worker. */
+	UHLSTATETREE_API void RunOnGameThread(TUniqueFunction<void()>&& Command);
+
+	/** Routes RunOnGameThread of the current thread into Buffer while in scope. */
+	struct UHLSTATETREE_API FCommandScope
+	{
+		explicit FCommandScope(FUHLStateTreeCommandBuffer& Buffer);
+		~FCommandScope();
+
+	private:
+		FUHLStateTreeCommandBuffer* PreviousBuffer = nullptr;
+	};
+}
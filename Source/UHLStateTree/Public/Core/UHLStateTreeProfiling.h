@@ -0,0 +1,137 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StateTreeTypes.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+#include "Core/UHLStateTreeTelemetry.h"
+#include <atomic>
+
+DECLARE_STATS_GROUP(TEXT("UHLStateTree"), STATGROUP_UHLStateTree, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("InRange"), STAT_UHLStateTree_InRange, STATGROUP_UHLStateTree, UHLSTATETREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("InAngle"), STAT_UHLStateTree_InAngle, STATGROUP_UHLStateTree, UHLSTATETREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TagCooldown"), STAT_UHLStateTree_TagCooldown, STATGROUP_UHLStateTree, UHLSTATETREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ClearFocus"), STAT_UHLStateTree_ClearFocus, STATGROUP_UHLStateTree, UHLSTATETREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("GameplayFocus"), STAT_UHLStateTree_GameplayFocus, STATGROUP_UHLStateTree, UHLSTATETREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PlayAnimMontage"), STAT_UHLStateTree_PlayAnimMontage, STATGROUP_UHLStateTree, UHLSTATETREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SetCooldown"), STAT_UHLStateTree_SetCooldown, STATGROUP_UHLStateTree, UHLSTATETREE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TurnTo"), STAT_UHLStateTree_TurnTo, STATGROUP_UHLStateTree, UHLSTATETREE_API);
+
+/**
+ * Condition results and task statuses of UHL nodes, off by default.
+ * Enabled with -trace=UHLStateTree or at runtime with Trace.Enable UHLStateTree.
+ */
+UE_TRACE_CHANNEL_EXTERN(UHLStateTreeChannel, UHLSTATETREE_API);
+
+/**
+ * Time spent in UHL nodes. Nodes show in stat UHLStateTree and as UHLStateTree_<Node> scopes in Insights,
+ * UUHLStateTreeBenchmark additionally sums them up while a capture runs.
+ */
+namespace UHLStateTreeProfiling
+{
+	enum class ENode : uint8
+	{
+		InRange,
+		InAngle,
+		TagCooldown,
+		ClearFocus,
+		GameplayFocus,
+		PlayAnimMontage,
+		SetCooldown,
+		TurnTo,
+		MAX
+	};
+
+	struct FNodeTiming
+	{
+		uint64 Calls = 0;
+		uint64 Cycles = 0;
+	};
+
+	UHLSTATETREE_API const TCHAR* GetNodeName(ENode Node);
+
+	UHLSTATETREE_API void BeginCapture();
+	UHLSTATETREE_API void EndCapture();
+	UHLSTATETREE_API void ResetNodeTimings();
+	UHLSTATETREE_API FNodeTiming GetNodeTiming(ENode Node);
+	UHLSTATETREE_API void AddNodeTiming(ENode Node, uint64 Cycles);
+
+	UHLSTATETREE_API void TraceConditionResult(ENode Node, const UObject* Owner, bool bResult);
+	UHLSTATETREE_API void TraceTaskStatus(ENode Node, const UObject* Owner, EStateTreeRunStatus Status, bool bEnterState);
+
+	inline bool IsTraceEnabled()
+	{
+#if UE_TRACE_ENABLED
+		return UE_TRACE_CHANNELEXPR_IS_ENABLED(UHLStateTreeChannel);
+#else
+		return false;
+#endif
+	}
+
+	extern UHLSTATETREE_API std::atomic<bool> bCapturing;
+
+	inline bool IsCapturing() { return bCapturing.load(std::memory_order_relaxed); }
+
+	/** Adds the time of the enclosing node call, safe on workers of the parallel tick */
+	struct FNodeScope
+	{
+		explicit FNodeScope(ENode InNode)
+			: Node(InNode)
+			, StartCycles(IsCapturing() ? FPlatformTime::Cycles64() : 0)
+		{
+		}
+
+		~FNodeScope()
+		{
+			if (StartCycles != 0)
+			{
+				AddNodeTiming(Node, FPlatformTime::Cycles64() - StartCycles);
+			}
+		}
+
+		/** Passes bResult through, recording it on the trace channel and in telemetry */
+		bool Result(const UObject* Owner, bool bResult) const
+		{
+			UHLStateTreeTelemetry::AddConditionEvaluation();
+			if (IsTraceEnabled())
+			{
+				TraceConditionResult(Node, Owner, bResult);
+			}
+			return bResult;
+		}
+
+		/** Passes Status through, recording it on the trace channel */
+		EStateTreeRunStatus EnterStatus(const UObject* Owner, EStateTreeRunStatus Status) const
+		{
+			if (IsTraceEnabled())
+			{
+				TraceTaskStatus(Node, Owner, Status, true);
+			}
+			return Status;
+		}
+
+		/** Passes Status through, recording it on the trace channel if the task stops running */
+		EStateTreeRunStatus TickStatus(const UObject* Owner, EStateTreeRunStatus Status) const
+		{
+			if (IsTraceEnabled() && Status != EStateTreeRunStatus::Running)
+			{
+				TraceTaskStatus(Node, Owner, Status, false);
+			}
+			return Status;
+		}
+
+	private:
+		ENode Node;
+		uint64 StartCycles;
+	};
+}
+
+/** Opens stat, Insights and benchmark scopes of a node method, UHLNodeScope records results on the trace channel */
+#define UHL_STATETREE_NODE_SCOPE(Node) \
+	SCOPE_CYCLE_COUNTER(STAT_UHLStateTree_##Node); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(UHLStateTree_##Node); \
+	const UHLStateTreeProfiling::FNodeScope UHLNodeScope(UHLStateTreeProfiling::ENode::Node)
@@ -0,0 +1,80 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "UObject/Object.h"
+#include "UHLStateTreeSignificance.generated.h"
+
+class UUHLStateTreeAIComponent;
+
+/** How often the StateTree of an agent ticks. */
+UENUM(BlueprintType)
+enum class EUHLStateTreeTickRate : uint8
+{
+	EveryFrame = 0,
+	/** MediumRateInterval, 10Hz by default */
+	Medium = 1,
+	/** LowRateInterval, 2Hz by default */
+	Low = 2,
+};
+
+/**
+ * Rates the significance of an agent from 0 to 1 and maps it to a tick rate.
+ * Default rating combines distance to the closest player view, on-screen status and a combat tag.
+ * Subclass in C++ or Blueprint and override EvaluateSignificance for other rules.
+ */
+UCLASS(Blueprintable, EditInlineNew, DefaultToInstanced, CollapseCategories)
+class UHLSTATETREE_API UUHLStateTreeSignificanceEvaluator : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintNativeEvent, BlueprintPure, Category = "Significance")
+	float EvaluateSignificance(const UUHLStateTreeAIComponent* Component, const TArray<FVector>& ViewLocations) const;
+
+	/**
+	 * Promotes right away, demotes one rate at a time after significance stays below the threshold minus
+	 * HysteresisMargin for DemotionDelay seconds, so agents near a threshold don't flicker between rates.
+	 */
+	EUHLStateTreeTickRate SelectTickRate(float Significance, EUHLStateTreeTickRate CurrentRate, double& InOutDemotionStartTime, double Now) const;
+
+	float GetTickRateInterval(EUHLStateTreeTickRate Rate) const;
+
+	/** Significance at or above which the agent ticks every frame */
+	UPROPERTY(EditAnywhere, Category = "Tiers", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float EveryFrameSignificance = 0.66f;
+
+	/** Significance at or above which the agent ticks at Medium rate */
+	UPROPERTY(EditAnywhere, Category = "Tiers", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MediumRateSignificance = 0.33f;
+
+	UPROPERTY(EditAnywhere, Category = "Tiers", meta = (ClampMin = "0.0", Units = "Seconds"))
+	float MediumRateInterval = 0.1f;
+
+	UPROPERTY(EditAnywhere, Category = "Tiers", meta = (ClampMin = "0.0", Units = "Seconds"))
+	float LowRateInterval = 0.5f;
+
+	UPROPERTY(EditAnywhere, Category = "Tiers", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float HysteresisMargin = 0.05f;
+
+	UPROPERTY(EditAnywhere, Category = "Tiers", meta = (ClampMin = "0.0", Units = "Seconds"))
+	float DemotionDelay = 1.0f;
+
+	/** Full significance at or below this distance to the closest player view */
+	UPROPERTY(EditAnywhere, Category = "Rating", meta = (ClampMin = "0.0", Units = "Centimeters"))
+	float NearDistance = 1500.0f;
+
+	/** Zero distance significance at or beyond this distance */
+	UPROPERTY(EditAnywhere, Category = "Rating", meta = (ClampMin = "0.0", Units = "Centimeters"))
+	float FarDistance = 6000.0f;
+
+	/** Added when the pawn was rendered recently */
+	UPROPERTY(EditAnywhere, Category = "Rating", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float OnScreenBonus = 0.25f;
+
+	/** Pawn with this tag on its ability system is rated fully significant */
+	UPROPERTY(EditAnywhere, Category = "Rating")
+	FGameplayTag CombatTag;
+};
@@ -0,0 +1,49 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UHLStateTreeSnapshot.generated.h"
+
+class UStateTree;
+struct FStateTreeInstanceData;
+struct FUHLTagCooldowns;
+
+/**
+ * Saved run of a UUHLStateTreeAIComponent: execution state with active states, instance data of all nodes
+ * and tag cooldowns as remaining time. Objects are stored by path, so actor references only restore for
+ * actors with stable names, e.g. placed in the level. Runs with node instance objects or latent tasks
+ * can't be saved, see UHLStateTreeSnapshot::CanSnapshot.
+ */
+USTRUCT(BlueprintType)
+struct UHLSTATETREE_API FUHLStateTreeSnapshot
+{
+	GENERATED_BODY()
+
+	/** Bumped when the layout of Data changes, older snapshots are rejected. */
+	static constexpr uint8 Version = 1;
+
+	/** Tree the snapshot was taken from, restoring requires the same one */
+	UPROPERTY(SaveGame)
+	TSoftObjectPtr<UStateTree> StateTree;
+
+	UPROPERTY(SaveGame)
+	TArray<uint8> Data;
+
+	bool IsValid() const { return Data.Num() > 0; }
+};
+
+namespace UHLStateTreeSnapshot
+{
+	/**
+	 * False if InstanceData holds node instance objects, e.g. Blueprint tasks, latent tasks waiting on delegates
+	 * bound in EnterState, e.g. PlayAnimMontage, or focus tasks holding focus arbiter requests. None survives a restore.
+	 */
+	UHLSTATETREE_API bool CanSnapshot(const FStateTreeInstanceData& InstanceData, FString* OutReason = nullptr);
+
+	/** Writes InstanceData and TagCooldowns relative to Now into OutData, fails if CanSnapshot is false. */
+	UHLSTATETREE_API bool Write(FStateTreeInstanceData& InstanceData, const FUHLTagCooldowns& TagCooldowns, double Now, TArray<uint8>& OutData);
+
+	/** Reads data written by Write, cooldowns resume relative to Now. */
+	UHLSTATETREE_API bool Read(const TArray<uint8>& Data, double Now, FStateTreeInstanceData& OutInstanceData, FUHLTagCooldowns& OutTagCooldowns);
+}
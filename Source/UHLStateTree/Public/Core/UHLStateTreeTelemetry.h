@@ -0,0 +1,66 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UHLStateTreeTelemetry.generated.h"
+
+/** Plugin wide counters of the last finished frame, summed over all worlds. */
+USTRUCT(BlueprintType)
+struct UHLSTATETREE_API FUHLStateTreeTelemetry
+{
+	GENERATED_BODY()
+
+	/** UUHLStateTreeAIComponents running a tree */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 ActiveAgents = 0;
+
+	/** Running agents with tick disabled until woken up */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 SleepingAgents = 0;
+
+	/** Agent trees ticked during the frame */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 TickedAgents = 0;
+
+	/** TestCondition calls of UHL conditions */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 ConditionEvaluations = 0;
+
+	/** Montage multicasts sent by UUHLMontageReplicatorObjects, replicated montage state isn't counted */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 MontageRPCs = 0;
+
+	/** Cooldown table entries of the ticked agents */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	float AvgCooldownEntries = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 MaxCooldownEntries = 0;
+
+	/** Tree tick time of the ticked agents */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	float AvgAgentTickMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	float MaxAgentTickMs = 0.0f;
+};
+
+/**
+ * Counters behind FUHLStateTreeTelemetry. Safe on workers of the parallel tick, always on.
+ * Published at the end of every frame and recorded into the UHLStateTree category of the CSV profiler.
+ */
+namespace UHLStateTreeTelemetry
+{
+	/** Counters of the last finished frame */
+	UHLSTATETREE_API FUHLStateTreeTelemetry GetLastFrame();
+
+	UHLSTATETREE_API void AddActiveAgent(int32 Delta);
+	UHLSTATETREE_API void AddSleepingAgent(int32 Delta);
+	UHLSTATETREE_API void AddConditionEvaluation();
+	UHLSTATETREE_API void AddMontageRPC();
+	UHLSTATETREE_API void AddAgentTick(uint64 Cycles, int32 CooldownEntries);
+
+	/** Publishes and resets the per frame counters, bound to the end of the engine frame by the module */
+	void EndFrame();
+}
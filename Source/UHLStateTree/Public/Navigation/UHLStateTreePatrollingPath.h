@@ -23,6 +23,7 @@ protected:
     TObjectPtr<USplineComponent> Spline;
 
 private:
-    TArray<FVector>* Waypoints = new TArray<FVector>();
+    /** Rebuilt from the spline on every GetWaypoints, keeps its allocation between calls */
+    mutable TArray<FVector> Waypoints;
 
 };
@@ -6,8 +6,107 @@
 #include "UObject/Object.h"
 #include "Animation/AnimMontage.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Engine/EngineBaseTypes.h"
 #include "UHLMontageReplicatorObject.generated.h"
 
+/** How montage RPCs of the replicator are delivered to clients. */
+UENUM(BlueprintType)
+enum class EUHLMontageNetDelivery : uint8
+{
+	/** Guaranteed and ordered, use for gameplay-relevant montages. */
+	Reliable = 0,
+	/** Fire-and-forget, use for cosmetic montages that can be lost under packet loss. */
+	Unreliable = 1,
+	/** Replicated as per-mesh montage state, seen by late joiners and clients that become relevant later. */
+	ReplicatedState = 2,
+};
+
+/**
+ * Compact montage play payload. Montage and mesh are indices into the replicator tables,
+ * section is an index into the montage composite sections, rate and position are quantized.
+ */
+USTRUCT()
+struct UHLSTATETREE_API FUHLMontagePlayPacket
+{
+	GENERATED_BODY()
+
+	static constexpr uint8 InvalidIndex = MAX_uint8;
+	static constexpr float PlayRateScale = 1000.0f;
+	static constexpr float PositionScale = 100.0f;
+
+	UPROPERTY()
+	uint8 MeshSlot = InvalidIndex;
+
+	UPROPERTY()
+	uint8 MontageIndex = InvalidIndex;
+
+	UPROPERTY()
+	uint8 SectionIndex = InvalidIndex;
+
+	/** PlayRate * PlayRateScale */
+	UPROPERTY()
+	uint16 QuantizedPlayRate = 0;
+
+	/** StartPosition * PositionScale */
+	UPROPERTY()
+	uint16 QuantizedStartPosition = 0;
+
+	float GetPlayRate() const { return QuantizedPlayRate / PlayRateScale; }
+	float GetStartPosition() const { return QuantizedStartPosition / PositionScale; }
+
+	/** Returns false if values don't fit the quantized range. */
+	bool SetPlayRate(float PlayRate);
+	bool SetStartPosition(float StartPosition);
+};
+
+/**
+ * One montage operation on a mesh slot: stop all montages, play a montage, or stop all and then play.
+ */
+USTRUCT()
+struct UHLSTATETREE_API FUHLMontageOp
+{
+	GENERATED_BODY()
+
+	/** MontageIndex is InvalidIndex for stop-only operations. */
+	UPROPERTY()
+	FUHLMontagePlayPacket Play;
+
+	/** If true, all montages on the mesh are stopped before playing. */
+	UPROPERTY()
+	bool bStopAllMontages = false;
+
+	/** BlendOutTime * FUHLMontagePlayPacket::PositionScale used by the stop */
+	UPROPERTY()
+	uint16 QuantizedBlendOutTime = 0;
+
+	bool HasPlay() const { return Play.MontageIndex != FUHLMontagePlayPacket::InvalidIndex; }
+	float GetBlendOutTime() const { return QuantizedBlendOutTime / FUHLMontagePlayPacket::PositionScale; }
+	void SetBlendOutTime(float BlendOutTime);
+};
+
+/**
+ * Replicated montage state of one mesh slot, applied on clients from OnRep similar to ACharacter::RepAnimMontageInfo.
+ */
+USTRUCT()
+struct UHLSTATETREE_API FUHLRepMeshMontageInfo
+{
+	GENERATED_BODY()
+
+	/** Last operation on the slot. No play means montages were stopped. */
+	UPROPERTY()
+	FUHLMontageOp Op;
+
+	/** Server world time the montage started at, late joiners resume from the elapsed position. */
+	UPROPERTY()
+	double ServerStartTime = 0.0;
+
+	/** Bumped on every change, so playing the same montage again still replicates. */
+	UPROPERTY()
+	uint8 ChangeCounter = 0;
+
+	bool IsPlaying() const { return Op.HasPlay(); }
+};
+
 UCLASS()
 class UHLSTATETREE_API UUHLMontageReplicatorObject : public UObject
 {
@@ -18,11 +117,56 @@ public:
 
 	// Required so the UObject can take part in networking
 	virtual bool IsSupportedForNetworking() const override { return true; }
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual int32 GetFunctionCallspace(UFunction* Function, FFrame* Stack) override;
 	virtual bool CallRemoteFunction(UFunction* Function, void* Params, FOutParmRec* OutParms, FFrame* Stack) override;
 	virtual UWorld* GetWorld() const override { return Owner ? Owner->GetWorld() : nullptr; }
+	/** Takes Owner from the outer, so replicated copies created on clients know their actor too */
+	virtual void PostInitProperties() override;
+
+	/**
+	 * Returns the replicator registered on InOwner, or nullptr if none was created yet.
+	 * Walks the owner's subobjects, UUHLStateTreeAIComponent::GetMontageReplicator caches the result.
+	 */
+	static UUHLMontageReplicatorObject* Find(const AActor* InOwner);
+
+	/**
+	 * Returns the single replicator of InOwner, lazily creating and registering it as a replicated subobject.
+	 * The replicator unregisters itself when the owner ends play. Authority only.
+	 * Owner must replicate using the registered subobject list, that's the only path Iris supports.
+	 */
+	static UUHLMontageReplicatorObject* GetOrCreate(AActor* InOwner);
 
 	void Initialize(AActor* InOwner);
+	void Deinitialize();
+
+	/** Adds montages to the replicated montage table, so later plays can be sent as an index. Authority only. */
+	void RegisterMontages(TConstArrayView<UAnimMontage*> Montages);
+
+	/**
+	 * Plays montage on Mesh on the server right away and replicates it to clients. If StopAllBlendOutTime is set,
+	 * all montages on Mesh are stopped first as part of the same operation.
+	 * RPC deliveries are batched: all operations of this owner within a frame are sent as one multicast.
+	 * Falls back to Multicast_PlayMontage when montage or mesh don't fit the tables. Authority only.
+	 * bPlayOnServer false only replicates the montage, used by dedicated servers that skip animation evaluation.
+	 * Returns false if nothing was played or sent, only possible with bPlayOnServer false when the op doesn't fit
+	 * the tables or the quantized range, the caller should play the montage on the server instead.
+	 */
+	bool PlayMontage(
+		USkeletalMeshComponent* Mesh,
+		UAnimMontage* Montage,
+		float PlayRate,
+		float StartPosition,
+		FName StartSection,
+		EUHLMontageNetDelivery Delivery = EUHLMontageNetDelivery::Reliable,
+		TOptional<float> StopAllBlendOutTime = {},
+		bool bPlayOnServer = true);
+
+	/** Stops all montages on Mesh on the server right away and replicates it to clients. Authority only. */
+	void StopAllMontages(
+		USkeletalMeshComponent* Mesh,
+		float BlendOutTime,
+		EUHLMontageNetDelivery Delivery = EUHLMontageNetDelivery::Reliable);
 
 	UFUNCTION(NetMulticast, Reliable)
 	void Multicast_PlayMontage(
@@ -35,9 +179,67 @@ public:
 	UFUNCTION(NetMulticast, Reliable)
 	void Multicast_StopAllMontages(USkeletalMeshComponent* Mesh, float BlendOutTime);
 
+	/** Operations batched within one frame. Already applied on the server. */
+	UFUNCTION(NetMulticast, Reliable)
+	void Multicast_MontageOps(const TArray<FUHLMontageOp>& Ops);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multicast_MontageOpsUnreliable(const TArray<FUHLMontageOp>& Ops);
+
 private:
+	UFUNCTION()
+	void OnOwnerEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+
+	UFUNCTION()
+	void OnRep_Tables();
+
+	UFUNCTION()
+	void OnRep_MeshMontageStates();
+
+	/** Applies replicated states that changed since the last apply. */
+	void ApplyMeshMontageStates();
+	FUHLRepMeshMontageInfo& GetMutableMeshMontageState(int32 MeshSlot);
+	void MarkMeshMontageStateDirty(FUHLRepMeshMontageInfo& State);
+	double GetServerWorldTimeSeconds() const;
+
+	int32 FindOrAddMontageIndex(UAnimMontage* Montage);
+	int32 FindOrAddMeshSlot(USkeletalMeshComponent* Mesh);
+
+	/** Replicates an operation that was already applied on the server. */
+	void SendOp(const FUHLMontageOp& Op, EUHLMontageNetDelivery Delivery);
+	void FlushPendingOps(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	/** Sends batched operations right away, before any RPC that must arrive after them. */
+	void SendPendingOps();
+	void ReceiveOps(const TArray<FUHLMontageOp>& Ops, bool bQueueUnresolved);
+
+	/** Returns false if operation references table entries that haven't replicated yet. */
+	bool ApplyOp(const FUHLMontageOp& Op);
+	static void PlayMontageLocal(USkeletalMeshComponent* Mesh, UAnimMontage* Montage, float PlayRate, float StartPosition, FName StartSection);
+
+	/** Outer actor, set on the server and on clients */
 	UPROPERTY()
 	TObjectPtr<AActor> Owner = nullptr;
-};
 
+	/** Montages that can be sent by index. Prebuilt from the owner's StateTree and extended on first use. */
+	UPROPERTY(ReplicatedUsing=OnRep_Tables)
+	TArray<TObjectPtr<UAnimMontage>> MontageTable;
+
+	/** Meshes that can be sent by slot. */
+	UPROPERTY(ReplicatedUsing=OnRep_Tables)
+	TArray<TObjectPtr<USkeletalMeshComponent>> MeshSlots;
 
+	/** Montage state per mesh slot, indexed by slot. */
+	UPROPERTY(ReplicatedUsing=OnRep_MeshMontageStates)
+	TArray<FUHLRepMeshMontageInfo> MeshMontageStates;
+
+	/** ChangeCounter of each slot state already applied on this client. */
+	TArray<int32> AppliedStateCounters;
+
+	/** Operations of the current frame waiting for FlushPendingOps. */
+	TArray<FUHLMontageOp> PendingReliableOps;
+	TArray<FUHLMontageOp> PendingUnreliableOps;
+	FDelegateHandle FlushHandle;
+
+	/** Operations received before the tables they reference, replayed from OnRep_Tables. */
+	TArray<FUHLMontageOp> UnresolvedOps;
+};
@@ -0,0 +1,88 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UHLFocusRotationSubsystem.generated.h"
+
+class AAIController;
+class AUHLStateTreeAIController;
+class APawn;
+class UUHLFocusRotationSubsystem;
+
+/** Runs the focus rotation batch in TG_PrePhysics, registered pawns and their movement tick after it */
+USTRUCT()
+struct FUHLFocusRotationTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UUHLFocusRotationSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FUHLFocusRotationTickFunction> : public TStructOpsTypeTraitsBase2<FUHLFocusRotationTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Updates control rotation from focus for all registered AIControllers in one batch instead of each controller's Tick.
+ * Gathers pawn and focus data, computes rotations in a tight loop (parallel for large crowds) and applies them once.
+ * Controllers must be AUHLStateTreeAIControllers, which skip only their own UpdateControlRotation while registered.
+ * The batch runs in a pre-physics tick function the registered pawns and their movement components depend on,
+ * so movement sees the rotation of the same frame.
+ */
+UCLASS()
+class UHLSTATETREE_API UUHLFocusRotationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UUHLFocusRotationSubsystem* Get(const UWorld* World);
+
+	/** InterpSpeed in degrees per second, 0 snaps to focus like AAIController does. Returns false if Controller can't be batched. */
+	bool RegisterController(AAIController* Controller, float InterpSpeed = 0.0f);
+	void UnregisterController(AAIController* Controller);
+
+	virtual void Deinitialize() override;
+
+	/** Computes and applies control rotations of all registered controllers, called by the tick function. */
+	void UpdateRotations(float DeltaTime);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FAgent
+	{
+		TWeakObjectPtr<AUHLStateTreeAIController> Controller;
+		/** Pawn whose ticks were made to depend on the tick function */
+		TWeakObjectPtr<APawn> Pawn;
+		float InterpSpeed = 0.0f;
+	};
+
+	void AddPawnPrerequisites(APawn* Pawn);
+	void RemovePawnPrerequisites(APawn* Pawn);
+
+	TArray<FAgent> Agents;
+
+	FUHLFocusRotationTickFunction TickFunction;
+
+	/** Per frame batch, kept to avoid reallocating */
+	TArray<int32> BatchAgents;
+	TArray<FVector> BatchViewLocations;
+	TArray<FVector> BatchFocalPoints;
+	TArray<FRotator> BatchCurrentRotations;
+	TArray<FRotator> BatchPawnRotations;
+	TArray<uint8> BatchFlags;
+	TArray<FRotator> BatchResults;
+};
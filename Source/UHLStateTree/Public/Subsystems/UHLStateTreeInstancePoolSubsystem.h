@@ -0,0 +1,73 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StateTreeInstanceData.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "UHLStateTreeInstancePoolSubsystem.generated.h"
+
+class UStateTree;
+
+/** Pool numbers since the world started. */
+USTRUCT(BlueprintType)
+struct UHLSTATETREE_API FUHLStateTreeInstancePoolStats
+{
+	GENERATED_BODY()
+
+	/** Instance data waiting in the pool for all trees */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 PooledInstances = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 Acquired = 0;
+
+	/** Acquires served from the pool instead of fresh instance data */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 Reused = 0;
+};
+
+/**
+ * Recycles StateTree instance data of despawned UUHLStateTreeAIComponents, keyed by StateTree asset.
+ * Released instance data is reset, which drops node instances but keeps the instance storage and its buffers,
+ * so the next component starting the same tree doesn't allocate them again.
+ * Capped by uhl.StateTree.InstancePool.MaxPerTree.
+ */
+UCLASS()
+class UHLSTATETREE_API UUHLStateTreeInstancePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UUHLStateTreeInstancePoolSubsystem* Get(const UWorld* World);
+
+	/** Swaps pooled instance data of StateTree into InOutInstanceData, returns false if the pool had none. */
+	bool Acquire(const UStateTree* StateTree, FStateTreeInstanceData& InOutInstanceData);
+
+	/** Resets InOutInstanceData and moves it to the pool, InOutInstanceData gets an empty one. */
+	void Release(const UStateTree* StateTree, FStateTreeInstanceData& InOutInstanceData);
+
+	/**
+	 * Fills the pool of StateTree up to Count instances, e.g. at level load before a wave spawns.
+	 * Each instance is built from the tree's default instance data, so its buffers are already sized for the tree.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	void Prewarm(const UStateTree* StateTree, int32 Count);
+
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	int32 GetPooledCount(const UStateTree* StateTree) const;
+
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	FUHLStateTreeInstancePoolStats GetPoolStats() const { return Stats; }
+
+	virtual void Deinitialize() override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	TMap<FObjectKey, TArray<FStateTreeInstanceData>> Pools;
+
+	FUHLStateTreeInstancePoolStats Stats;
+};
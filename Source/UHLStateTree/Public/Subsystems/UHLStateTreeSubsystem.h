@@ -0,0 +1,161 @@
+// Pavel Penkov 2025 All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+#include "Core/UHLStateTreeTelemetry.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UHLStateTreeSubsystem.generated.h"
+
+class UUHLStateTreeAIComponent;
+
+/** Order in which the scheduler spends its frame budget. */
+UENUM(BlueprintType)
+enum class EUHLStateTreeTickPriority : uint8
+{
+	/** Ticked every frame regardless of the budget, e.g. bosses */
+	Critical = 0,
+	High = 1,
+	Normal = 2,
+	Low = 3,
+	MAX UMETA(Hidden)
+};
+
+/** Scheduler numbers of the last frame. */
+USTRUCT(BlueprintType)
+struct UHLSTATETREE_API FUHLStateTreeTickStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 RegisteredAgents = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 TickedAgents = 0;
+
+	/** Agents ticked on worker threads, see UUHLStateTreeAIComponent::bAllowParallelTick */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 ParallelAgents = 0;
+
+	/** Agents with tick disabled until woken up, see UUHLStateTreeAIComponent::bAllowSleep */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 SleepingAgents = 0;
+
+	/** Agents ticked over budget because they were stale for longer than uhl.StateTree.MaxTickStaleness */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	int32 ForcedAgents = 0;
+
+	/** Longest time any registered agent went without a tick beyond its tick rate interval, seconds */
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	float WorstStaleness = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "UHLStateTree")
+	float UsedMs = 0.0f;
+};
+
+/**
+ * Ticks UUHLStateTreeAIComponents of the world within uhl.StateTree.TickBudgetMs per frame instead of each component's own tick.
+ * Agents are ticked round-robin per priority class, higher classes first, and receive the time since their last tick,
+ * so skipped agents catch up with one larger delta. Disabled while the budget is 0.
+ * Also re-evaluates significance driven tick rates of agents and wakes up sleeping agents, with or without the budget.
+ */
+UCLASS()
+class UHLSTATETREE_API UUHLStateTreeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UUHLStateTreeSubsystem* Get(const UWorld* World);
+
+	/** True if components should register instead of ticking themselves. */
+	static bool IsSchedulingEnabled();
+
+	/** Takes over ticking of Component, its own tick is disabled until unregistered. */
+	void RegisterComponent(UUHLStateTreeAIComponent* Component, EUHLStateTreeTickPriority Priority);
+	void UnregisterComponent(UUHLStateTreeAIComponent* Component);
+
+	/**
+	 * Ticks Component's tree on task graph workers together with other parallel agents, outside the budget.
+	 * Caller checks the tree is thread-safe. Unregistered with UnregisterComponent.
+	 */
+	void RegisterParallelComponent(UUHLStateTreeAIComponent* Component);
+
+	/** Re-evaluates significance and tick rate of Component periodically, see UUHLStateTreeAIComponent::SignificanceEvaluator. */
+	void RegisterSignificance(UUHLStateTreeAIComponent* Component);
+	void UnregisterSignificance(UUHLStateTreeAIComponent* Component);
+
+	/** Polls Component for wake up conditions every frame while it sleeps. */
+	void RegisterSleeping(UUHLStateTreeAIComponent* Component);
+	void UnregisterSleeping(UUHLStateTreeAIComponent* Component);
+
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	int32 GetSleepingAgentCount() const { return SleepingAgents.Num(); }
+
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	FUHLStateTreeTickStats GetTickStats() const { return Stats; }
+
+	/** Plugin wide counters of the last frame, same as recorded by the CSV profiler. */
+	UFUNCTION(BlueprintCallable, Category = "UHLStateTree")
+	FUHLStateTreeTelemetry GetTelemetry() const { return UHLStateTreeTelemetry::GetLastFrame(); }
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FAgent
+	{
+		TWeakObjectPtr<UUHLStateTreeAIComponent> Component;
+		double LastTickTime = 0.0;
+		bool bWasTickEnabled = true;
+	};
+
+	struct FPriorityClass
+	{
+		TArray<FAgent> Agents;
+		/** Round-robin position, next agent to tick */
+		int32 Cursor = 0;
+	};
+
+	struct FPendingRegistration
+	{
+		TWeakObjectPtr<UUHLStateTreeAIComponent> Component;
+		EUHLStateTreeTickPriority Priority = EUHLStateTreeTickPriority::Normal;
+		bool bParallel = false;
+	};
+
+	void AddAgent(FPriorityClass& Class, UUHLStateTreeAIComponent* Component);
+	bool RemoveAgent(FPriorityClass& Class, UUHLStateTreeAIComponent* Component);
+	void TickAgent(FAgent& Agent, double Now);
+	void TickParallelAgents(double Now);
+	void UpdateSignificance(double Now);
+	void WakeUpSleepingAgents(double Now);
+
+	TStaticArray<FPriorityClass, static_cast<int32>(EUHLStateTreeTickPriority::MAX)> Classes;
+
+	/** Agents ticked in parallel, the cursor is unused */
+	FPriorityClass ParallelClass;
+
+	/** Per frame parallel batch, kept to avoid reallocating */
+	TArray<TPair<UUHLStateTreeAIComponent*, float>> ParallelBatch;
+
+	/** Components ticked by the scheduler may start or stop logic, changes are deferred until the frame is done */
+	bool bTickingAgents = false;
+	TArray<FPendingRegistration> PendingRegistrations;
+
+	FUHLStateTreeTickStats Stats;
+
+	TArray<TWeakObjectPtr<UUHLStateTreeAIComponent>> SleepingAgents;
+	/** Kept to avoid reallocating */
+	TArray<UUHLStateTreeAIComponent*> AgentsToWakeUp;
+
+	TArray<TWeakObjectPtr<UUHLStateTreeAIComponent>> SignificanceAgents;
+	double NextSignificanceUpdateTime = 0.0;
+
+	/** Player view locations gathered for significance, kept to avoid reallocating */
+	TArray<FVector> ViewLocations;
+};
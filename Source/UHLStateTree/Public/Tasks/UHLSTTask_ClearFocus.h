@@ -23,6 +23,16 @@ struct UHLSTATETREE_API FUHLSTTask_ClearFocusInstanceData
 	
 	UPROPERTY(EditAnywhere, Category = "Parameter")
 	bool bFinishTask = true;
+
+	/**
+	 * Focus requests of other UHL nodes up to this priority are dropped. If the task keeps running,
+	 * it also keeps lower priority requests off the slot until it exits, see FUHLFocusArbiter.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Parameter")
+	int32 RequestPriority = 0;
+
+	/** Arbiter key of this instance, see UHLFocus::MakeOwnerKey */
+	const void* FocusOwner = nullptr;
 };
 
 USTRUCT(meta = (DisplayName = "ClearFocus", Category="UHLStateTree"))
@@ -37,6 +47,7 @@ struct UHLSTATETREE_API FUHLSTTask_ClearFocus : public FStateTreeTaskCommonBase
 	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
 
 	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 #if WITH_EDITOR
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
 	virtual FName GetIconName() const override;
@@ -37,6 +37,13 @@ struct UHLSTATETREE_API FUHLSTTask_GameplayFocusInstanceData
 	
 	UPROPERTY(EditAnywhere, Category = "Parameter")
 	bool bEnable = true;
+
+	/** Wins over lower priority focus of other UHL nodes on the same slot, see FUHLFocusArbiter */
+	UPROPERTY(EditAnywhere, Category = "Parameter")
+	int32 RequestPriority = 0;
+
+	/** Arbiter key of this instance, see UHLFocus::MakeOwnerKey */
+	const void* FocusOwner = nullptr;
 };
 
 USTRUCT(meta = (DisplayName = "GameplayFocus", Category="UHLStateTree"))
@@ -52,6 +59,7 @@ struct UHLSTATETREE_API FUHLSTTask_GameplayFocus : public FStateTreeTaskCommonBa
 
 	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 	
 #if WITH_EDITOR
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
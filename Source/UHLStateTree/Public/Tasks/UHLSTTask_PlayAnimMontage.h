@@ -4,12 +4,13 @@
 
 #include "StateTreeTaskBase.h"
 #include "UObject/NameTypes.h"
+#include "Net/UHLMontageReplicatorObject.h"
+#include "Core/UHLMontageNotifyListener.h"
 #include "UHLSTTask_PlayAnimMontage.generated.h"
 
 class ACharacter;
 class USkeletalMeshComponent;
 class UAnimMontage;
-class UUHLStateTreeAIComponent;
 
 enum class EStateTreeRunStatus : uint8;
 struct FStateTreeTransitionResult;
@@ -29,6 +30,13 @@ struct UHLSTATETREE_API FUHLSTTask_PlayAnimMontageInstanceData
 	UPROPERTY(EditAnywhere, Category = "Parameter")
 	TObjectPtr<UAnimMontage> AnimMontage = nullptr;
 
+	/**
+	 * Used when AnimMontage isn't set. Keeps the montage out of memory until a tree that can play it is live,
+	 * UUHLStateTreeAIComponent streams it in when the tree is set or started.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Parameter")
+	TSoftObjectPtr<UAnimMontage> SoftAnimMontage;
+
 	UPROPERTY(EditAnywhere, Category = "Parameter")
 	float PlayRate = 1.0f;
 
@@ -43,6 +51,22 @@ struct UHLSTATETREE_API FUHLSTTask_PlayAnimMontageInstanceData
 	UPROPERTY(EditAnywhere, Category = "Parameter")
 	bool bShouldStopAllMontages = false;
 
+	/**
+	 * How montage plays on a custom mesh are sent to clients. ReplicatedState also reaches late joiners,
+	 * Unreliable suits cosmetic montages.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Replication")
+	EUHLMontageNetDelivery NetDelivery = EUHLMontageNetDelivery::Reliable;
+
+	/**
+	 * Dedicated server only: montage on CustomMesh isn't played on the server, only replicated to clients, and the task
+	 * finishes by a timer computed from montage length, play rate and sections. Montages with root motion, montages on
+	 * the character's mesh and plays that can't be sent as a montage op are still played on the server.
+	 * Notify events need the played montage, with NotifyEvents set the tree fails validation.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Replication")
+	bool bSkipAnimationOnDedicatedServer = false;
+
 	/** If true, finish task when montage completes naturally. */
 	UPROPERTY(EditAnywhere, Category = "Finish")
 	bool bFinishTaskOnCompleted = true;
@@ -59,21 +83,28 @@ struct UHLSTATETREE_API FUHLSTTask_PlayAnimMontageInstanceData
 	UPROPERTY(EditAnywhere, Category = "Finish")
 	bool bSucceededResult = true;
 
-	// Runtime flags set by delegates
+	/**
+	 * Montage notifies sent to the tree as events, e.g. "hit frame reached" or "combo window open".
+	 * Use "Montage Notify" and "Montage Notify Window", only notifies of the montage started by this task are forwarded.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Events")
+	TArray<FUHLSTMontageNotifyEvent> NotifyEvents;
+
+	/** Forwards NotifyEvents while the task is active */
 	UPROPERTY(Transient)
-	bool bCompletedTriggered = false;
+	TObjectPtr<UUHLMontageNotifyListener> NotifyListener = nullptr;
+
+	/** Montage resolved from AnimMontage or SoftAnimMontage on enter */
 	UPROPERTY(Transient)
-	bool bInterruptedTriggered = false;
+	TObjectPtr<UAnimMontage> PlayingMontage = nullptr;
+
+	/** Finishes the task when montage isn't played on a dedicated server */
 	UPROPERTY(Transient)
-	bool bBlendOutTriggered = false;
+	FTimerHandle FinishTimerHandle;
 
 	/** Delegates are bound on this AnimInstance to be cleared on exit */
 	UPROPERTY(Transient)
 	TWeakObjectPtr<UAnimInstance> BoundAnimInstance;
-
-	/** Owning StateTree component for RequestTransition. */
-	UPROPERTY(Transient)
-	TWeakObjectPtr<UUHLStateTreeAIComponent> StateTreeComponent;
 };
 
 /**
@@ -86,16 +117,16 @@ struct UHLSTATETREE_API FUHLSTTask_PlayAnimMontage : public FStateTreeTaskCommon
 
 	using FInstanceDataType = FUHLSTTask_PlayAnimMontageInstanceData;
 
-	FUHLSTTask_PlayAnimMontage() = default;
+	// Completion comes from montage delegates, nothing to do on tick
+	FUHLSTTask_PlayAnimMontage() { bShouldCallTick = false; }
 
 	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
 
 	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
-	// Lightweight tick: only checks flags set by montage delegates to finish the task.
-	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
 	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 
 #if WITH_EDITOR
+	virtual EDataValidationResult Compile(FStateTreeDataView InstanceDataView, TArray<FText>& ValidationMessages) override;
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
 	virtual FName GetIconName() const override { return FName("Icons.Play"); }
 	virtual FColor GetIconColor() const override { return UE::StateTree::Colors::Grey; }
@@ -103,6 +134,7 @@ struct UHLSTATETREE_API FUHLSTTask_PlayAnimMontage : public FStateTreeTaskCommon
 
 private:
 	USkeletalMeshComponent* ResolveMesh(const FInstanceDataType& InstanceData) const;
+	UAnimMontage* ResolveMontage(const FInstanceDataType& InstanceData) const;
 	bool IsMontagePlaying(USkeletalMeshComponent* Mesh, const UAnimMontage* Montage) const;
 };
 
@@ -52,6 +52,10 @@ struct UHLSTATETREE_API FUHLSTTask_TurnToInstanceData
 	UPROPERTY(EditAnywhere, Category = "Parameter")
 	bool bClearFocusOnSucceed = true;
 
+	/** Wins over lower priority focus of other UHL nodes on the Gameplay slot, see FUHLFocusArbiter */
+	UPROPERTY(EditAnywhere, Category = "Parameter")
+	int32 RequestPriority = 0;
+
 	// UPROPERTY(EditAnywhere, Category = "Parameter")
 	// bool bFinishTask = true;
 
@@ -62,6 +66,8 @@ struct UHLSTATETREE_API FUHLSTTask_TurnToInstanceData
 	FTurnSettings CurrentTurnSettings;
 	UPROPERTY(Transient)
 	FTurnRange CurrentTurnRange;
+	/** Arbiter key of this instance, see UHLFocus::MakeOwnerKey */
+	const void* FocusOwner = nullptr;
 
 	// /** Optional actor where to draw the text at. */
 	// UPROPERTY(EditAnywhere, Category = "Input", meta=(Optional))
@@ -84,6 +90,7 @@ struct UHLSTATETREE_API FUHLSTTask_TurnTo : public FStateTreeTaskCommonBase
 
 	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 #if WITH_EDITOR
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
 	virtual FName GetIconName() const override
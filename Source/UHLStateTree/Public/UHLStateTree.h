@@ -4,6 +4,8 @@
 
 #include "Modules/ModuleManager.h"
 
+UHLSTATETREE_API DECLARE_LOG_CATEGORY_EXTERN(LogUHLStateTree, Log, All);
+
 
 class FUHLStateTreeModule : public IModuleInterface
 {
@@ -11,4 +13,7 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+	FDelegateHandle EndFrameHandle;
 };
@@ -46,8 +46,12 @@ public class UHLStateTree : ModuleRules
 			new string[]
 			{
 				"StateTreeModule",
-				"GameplayStateTreeModule"
+				"GameplayStateTreeModule",
+				"Json"
 			}
 			);
+
+		// debug draws and on-screen messages have no one to show them on dedicated servers
+		PublicDefinitions.Add("UHL_STATETREE_WITH_COSMETICS=" + (Target.Type == TargetType.Server ? "0" : "1"));
 	}
 }